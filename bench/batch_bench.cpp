@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <span>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Batched operations benchmark on a tree far larger than the last level cache.
+Two equal trees of n even ints are built, then the same random batches of lookups, insertions of odd ints and
+removals of those are run once value by value and once through findBatch, insertBatch and removeBatch.
+The answers and the final contents of the two trees must agree, the run fails otherwise.
+Usage: batch_bench [n] [operations] [batch size]
+*/
+constexpr size_t Degree = 16;
+using Tree = BTree<int, Degree>;
+
+// run the batches one after another, by value or as a whole, and return the nanoseconds per value
+template <typename Operation>
+double perValueNs(const std::vector<int>& vals, size_t batch_size, Operation operation)
+{
+    bench::Timer timer;
+    for (size_t first = 0; first < vals.size(); first += batch_size)
+        operation(std::span<const int>(vals.data() + first, std::min(batch_size, vals.size() - first)));
+    return timer.elapsedMs() * 1e6 / vals.size();
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 8'000'000);
+    size_t operations = bench::parseCount(argc, argv, 2, 1'000'000);
+    size_t batch_size = bench::parseCount(argc, argv, 3, 256);
+
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; i++)
+        keys[i] = static_cast<int>(2 * i);
+    Tree by_value(keys.begin(), keys.end());
+    Tree batched(keys.begin(), keys.end());
+
+    std::mt19937 rng(11);
+    std::vector<int> lookups(operations);
+    for (int& key : lookups)
+        key = static_cast<int>(rng() % (2 * n)); // half of them are odd and miss
+    // distinct odd values, a repeated one would only bump a duplicate count
+    std::vector<int> insertions = bench::shuffledKeys(n, 13);
+    insertions.resize(std::min(operations, n));
+    for (int& key : insertions)
+        key = 2 * key + 1;
+    std::vector<int> removals = insertions;
+    std::shuffle(removals.begin(), removals.end(), rng);
+
+    size_t found_by_value = 0;
+    double find_ns = perValueNs(lookups, batch_size, [&](std::span<const int> batch)
+    {
+        for (int key : batch)
+            found_by_value += by_value.find(key).first != nullptr;
+    });
+    size_t found_batched = 0;
+    double find_batch_ns = perValueNs(lookups, batch_size, [&](std::span<const int> batch)
+    {
+        for (auto [node, index] : batched.findBatch(batch))
+            found_batched += node != nullptr;
+    });
+
+    double insert_ns = perValueNs(insertions, batch_size, [&](std::span<const int> batch)
+    {
+        for (int key : batch)
+            by_value.insert(key);
+    });
+    double insert_batch_ns = perValueNs(insertions, batch_size, [&](std::span<const int> batch)
+    {
+        batched.insertBatch(batch);
+    });
+
+    double remove_ns = perValueNs(removals, batch_size, [&](std::span<const int> batch)
+    {
+        for (int key : batch)
+            by_value.remove(key);
+    });
+    size_t removed_batched = 0;
+    double remove_batch_ns = perValueNs(removals, batch_size, [&](std::span<const int> batch)
+    {
+        for (bool removed : batched.removeBatch(batch))
+            removed_batched += removed;
+    });
+
+    std::cout << std::format("n = {}, t = {}, {} operations in batches of {}\n", n, Degree, operations, batch_size);
+    std::cout << std::format("find:    {:7.1f} ns/value    findBatch:   {:7.1f} ns/value    {:.2f}x\n",
+                             find_ns, find_batch_ns, find_ns / find_batch_ns);
+    std::cout << std::format("insert:  {:7.1f} ns/value    insertBatch: {:7.1f} ns/value    {:.2f}x\n",
+                             insert_ns, insert_batch_ns, insert_ns / insert_batch_ns);
+    std::cout << std::format("remove:  {:7.1f} ns/value    removeBatch: {:7.1f} ns/value    {:.2f}x\n",
+                             remove_ns, remove_batch_ns, remove_ns / remove_batch_ns);
+    if (found_by_value != found_batched || removed_batched != removals.size() ||
+        !std::equal(by_value.begin(), by_value.end(), batched.begin(), batched.end()))
+    {
+        std::cout << "ERROR: the trees differ\n";
+        return 1;
+    }
+    return 0;
+}
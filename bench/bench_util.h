@@ -0,0 +1,125 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/*
+Helpers shared by the benchmark executables.
+Every benchmark is a single translation unit, so the global allocation hooks below are defined here:
+include this header from exactly one source file per executable.
+The hooks count without synchronization; a multi-threaded benchmark that does not report allocations
+defines BENCH_NO_ALLOCATION_HOOKS before the include and keeps the default allocator.
+*/
+namespace bench
+{
+    inline size_t allocation_calls = 0;
+    inline size_t allocated_bytes = 0;
+    inline size_t live_bytes = 0;
+    inline size_t peak_live_bytes = 0;
+
+    struct AllocationSnapshot
+    {
+        size_t calls;
+        size_t bytes;
+        size_t peak_live;
+        size_t live;
+    };
+    inline AllocationSnapshot allocationSnapshot()
+    {
+        return { allocation_calls, allocated_bytes, peak_live_bytes, live_bytes };
+    }
+    inline void resetPeak()
+    {
+        peak_live_bytes = live_bytes;
+    }
+
+    class Timer
+    {
+        std::chrono::steady_clock::time_point start;
+    public:
+        Timer() : start(std::chrono::steady_clock::now()) {}
+        double elapsedMs()const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    // n distinct keys 0..n-1 in a random order
+    inline std::vector<int> shuffledKeys(size_t n, unsigned seed = 42)
+    {
+        std::vector<int> keys(n);
+        std::iota(keys.begin(), keys.end(), 0);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+        return keys;
+    }
+    inline size_t parseCount(int argc, char** argv, int index, size_t fallback)
+    {
+        return argc > index ? std::stoull(argv[index]) : fallback;
+    }
+}
+
+#if !defined(BENCH_NO_ALLOCATION_HOOKS)
+// the size header keeps operator delete able to account for the freed bytes,
+// the hooks stay out of line so the compiler does not analyse them inside every container
+[[gnu::noinline]] void* operator new(size_t size)
+{
+    void* block = std::malloc(size + alignof(std::max_align_t));
+    if (!block)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(block) = size;
+    bench::allocation_calls++;
+    bench::allocated_bytes += size;
+    bench::live_bytes += size;
+    bench::peak_live_bytes = std::max(bench::peak_live_bytes, bench::live_bytes);
+    return static_cast<std::byte*>(block) + alignof(std::max_align_t);
+}
+[[gnu::noinline]] void operator delete(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+    std::byte* block = static_cast<std::byte*>(ptr) - alignof(std::max_align_t);
+    bench::live_bytes -= *reinterpret_cast<size_t*>(block);
+    std::free(block);
+}
+[[gnu::noinline]] void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment)
+{
+    size_t header = std::max(static_cast<size_t>(alignment), alignof(std::max_align_t));
+    size_t total = (size + header + header - 1) / header * header;
+    void* block = std::aligned_alloc(header, total);
+    if (!block)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(block) = header;
+    *(static_cast<size_t*>(block) + 1) = size;
+    bench::allocation_calls++;
+    bench::allocated_bytes += size;
+    bench::live_bytes += size;
+    bench::peak_live_bytes = std::max(bench::peak_live_bytes, bench::live_bytes);
+    return static_cast<std::byte*>(block) + header;
+}
+[[gnu::noinline]] void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+    if (!ptr)
+        return;
+    size_t header = std::max(static_cast<size_t>(alignment), alignof(std::max_align_t));
+    std::byte* block = static_cast<std::byte*>(ptr) - header;
+    bench::live_bytes -= *(reinterpret_cast<size_t*>(block) + 1);
+    std::free(block);
+}
+[[gnu::noinline]] void operator delete(void* ptr, size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
+#endif
+#endif
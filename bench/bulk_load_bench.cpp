@@ -0,0 +1,52 @@
+#include <format>
+#include <iostream>
+#include <thread>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Bulk load benchmark: builds a tree from n sorted keys by repeated insert and by bulkLoad,
+single-threaded and with all hardware threads, and reports the build time and the peak heap.
+Usage: bulk_load_bench [n] [duplicates per key]
+*/
+constexpr size_t Degree = 16;
+
+template <typename Build>
+void measure(const std::string& name, size_t n, Build build)
+{
+    bench::resetPeak();
+    size_t live_before = bench::live_bytes;
+    bench::Timer timer;
+    {
+        BTree<int, Degree> tree;
+        build(tree);
+        double ms = timer.elapsedMs();
+        std::cout << std::format("{:<28} {:9.1f} ms ({:5.1f} ns/key), peak heap {:7.1f} MiB\n", name, ms, ms * 1e6 / n,
+                                 (bench::peak_live_bytes - live_before) / (1024.0 * 1024.0));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 5'000'000);
+    size_t duplicates = bench::parseCount(argc, argv, 2, 4);
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::vector<int> repeated;
+    repeated.reserve(n * duplicates);
+    for (int key : keys)
+        repeated.insert(repeated.end(), duplicates, key);
+
+    std::cout << std::format("n = {}, t = {}, {} hardware threads\n", n, Degree, threads);
+    measure("insert loop", n, [&](auto& tree) { for (int key : keys) tree.insert(key); });
+    measure("bulkLoad, fill 1.0", n, [&](auto& tree) { tree.bulkLoad(keys.begin(), keys.end()); });
+    measure("bulkLoad, fill 0.7", n, [&](auto& tree) { tree.bulkLoad(keys.begin(), keys.end(), 0.7); });
+    measure(std::format("bulkLoad, fill 1.0, {} threads", threads), n,
+            [&](auto& tree) { tree.bulkLoad(keys.begin(), keys.end(), 1.0, threads); });
+    measure(std::format("bulkLoad, {} copies per key", duplicates), n * duplicates,
+            [&](auto& tree) { tree.bulkLoad(repeated.begin(), repeated.end()); });
+    return 0;
+}
@@ -0,0 +1,125 @@
+#define BENCH_NO_ALLOCATION_HOOKS
+#include <atomic>
+#include <format>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "bench_util.h"
+#include "concurrent_tree.h"
+#include "tree.h"
+
+
+/*
+Concurrent throughput benchmark: 1, 2, 4, ... threads run a mix of lookups and updates on a tree prefilled with
+the n even keys of [0, 2n). Lookups hit random keys of that range, an update inserts an odd key and removes
+it again, so the contents are the same after every run and are checked against the prefill, and each of those
+removals must find the key. The ConcurrentBTree is compared with a BTree behind a reader-writer lock.
+The checks here only guard the measurement, tests/concurrent_stress_test.cpp checks the tree under contention.
+Usage: concurrent_bench [n] [operations per thread] [max threads]
+*/
+constexpr size_t Degree = 16;
+
+class LockedBTree
+{
+    BTree<int, Degree> tree;
+    mutable std::shared_mutex mutex;
+public:
+    void insert(int val)
+    {
+        std::unique_lock lock(this->mutex);
+        this->tree.insert(val);
+    }
+    bool remove(int val)
+    {
+        std::unique_lock lock(this->mutex);
+        this->tree.remove(val);
+        return true;
+    }
+    size_t count(int val)const
+    {
+        std::shared_lock lock(this->mutex);
+        return this->tree.count(val);
+    }
+};
+
+template <typename Tree>
+bool holdsPrefill(const Tree& tree, int n)
+{
+    for (int key = 0; key < 2 * n; key++)
+        if (tree.count(key) != static_cast<size_t>(key % 2 == 0))
+            return false;
+    return true;
+}
+
+// million operations per second over all threads
+template <typename Tree>
+double run(Tree& tree, int n, size_t threads, size_t operations, unsigned read_percent, std::atomic<size_t>& lost)
+{
+    std::latch start(static_cast<std::ptrdiff_t>(threads) + 1);
+    std::vector<std::jthread> workers;
+    for (size_t w = 0; w < threads; w++)
+    {
+        workers.emplace_back([&tree, &start, &lost, n, threads, operations, read_percent, w] {
+            std::mt19937 rng(static_cast<unsigned>(w) + 1);
+            size_t found = 0;
+            size_t missed = 0;
+            start.arrive_and_wait();
+            for (size_t i = 0; i < operations; i++)
+            {
+                if (rng() % 100 < read_percent)
+                {
+                    found += tree.count(static_cast<int>(rng() % (2 * static_cast<unsigned>(n))));
+                }
+                else
+                {
+                    // every thread updates its own odd keys, BTree would warn about a value inserted twice
+                    int key = 2 * static_cast<int>(rng() % (n / threads + 1) * threads + w) + 1;
+                    tree.insert(key);
+                    missed += !tree.remove(key);
+                }
+            }
+            lost += missed;
+            volatile size_t sink = found;
+            (void)sink;
+        });
+    }
+    bench::Timer timer;
+    start.arrive_and_wait();
+    workers.clear();
+    return static_cast<double>(threads * operations) / (timer.elapsedMs() * 1e3);
+}
+
+int main(int argc, char** argv)
+{
+    int n = static_cast<int>(bench::parseCount(argc, argv, 1, 1'000'000));
+    size_t operations = bench::parseCount(argc, argv, 2, 1'000'000);
+    size_t max_threads = bench::parseCount(argc, argv, 3, std::max(1u, std::thread::hardware_concurrency()));
+
+    ConcurrentBTree<int, Degree> concurrent;
+    LockedBTree locked;
+    for (int key = 0; key < 2 * n; key += 2)
+    {
+        concurrent.insert(key);
+        locked.insert(key);
+    }
+
+    std::cout << std::format("n = {}, t = {}, {} operations per thread, Mops/s\n", n, Degree, operations);
+    std::cout << std::format("{:>7} {:>8} {:>12} {:>12}\n", "reads", "threads", "concurrent", "locked");
+    bool valid = true;
+    std::atomic<size_t> lost = 0; // removals that did not find the key their thread had just inserted
+    for (unsigned read_percent : { 100u, 90u, 50u })
+    {
+        for (size_t threads = 1; threads <= max_threads; threads *= 2)
+        {
+            double concurrent_mops = run(concurrent, n, threads, operations, read_percent, lost);
+            double locked_mops = run(locked, n, threads, operations, read_percent, lost);
+            std::cout << std::format("{:>6}% {:>8} {:>12.2f} {:>12.2f}\n", read_percent, threads, concurrent_mops,
+                                     locked_mops);
+        }
+        valid = valid && holdsPrefill(concurrent, n) && holdsPrefill(locked, n) && lost == 0;
+    }
+    std::cout << (valid ? "contents match the prefill\n" : "ERROR: contents differ from the prefill\n");
+    return valid ? 0 : 1;
+}
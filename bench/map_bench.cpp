@@ -0,0 +1,103 @@
+#include <format>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "bench_util.h"
+#include "map.h"
+
+
+/*
+Map benchmark for string keys too long for the small string buffer and move-only values: BTreeMap against
+std::map, both with the transparent std::less<>. Times and counts the allocations of insertions with the keys moved
+in, lookups through std::string_view and through a std::string built from it, as a non-transparent map would need,
+and the removal of every key.
+Usage: map_bench [n]
+*/
+constexpr size_t Degree = 16;
+
+struct Payload
+{
+    size_t id;
+    size_t bytes;
+};
+
+struct Result
+{
+    double ms;
+    size_t allocations;
+};
+
+template <typename Operation>
+Result measure(Operation operation)
+{
+    size_t calls_before = bench::allocationSnapshot().calls;
+    bench::Timer timer;
+    operation();
+    double ms = timer.elapsedMs();
+    return { ms, bench::allocationSnapshot().calls - calls_before };
+}
+
+template <typename Map>
+void run(const char* name, const std::vector<std::string>& keys, const std::vector<std::string_view>& probes)
+{
+    Map map;
+    std::vector<std::string> owned = keys;
+    std::vector<std::unique_ptr<Payload>> payloads(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        payloads[i] = std::make_unique<Payload>(Payload{ i, keys[i].size() });
+
+    Result insert = measure([&]
+    {
+        for (size_t i = 0; i < owned.size(); i++)
+            map.try_emplace(std::move(owned[i]), std::move(payloads[i]));
+    });
+    size_t found = 0;
+    Result view_lookup = measure([&]
+    {
+        for (std::string_view probe : probes)
+            found += map.contains(probe);
+    });
+    Result string_lookup = measure([&]
+    {
+        for (std::string_view probe : probes)
+            found += map.contains(std::string(probe));
+    });
+    Result erase = measure([&]
+    {
+        for (const std::string& key : keys)
+            map.erase(key);
+    });
+    if (found != 2 * probes.size() || !map.empty())
+        throw std::runtime_error("The map lost a key");
+
+    double n = static_cast<double>(keys.size());
+    double lookups = static_cast<double>(probes.size());
+    std::cout << std::format("{}\n", name);
+    std::cout << std::format("  insert:              {:7.1f} ns/op  {:5.2f} allocations/op\n",
+                             insert.ms * 1e6 / n, insert.allocations / n);
+    std::cout << std::format("  find, string_view:   {:7.1f} ns/op  {:5.2f} allocations/op\n",
+                             view_lookup.ms * 1e6 / lookups, view_lookup.allocations / lookups);
+    std::cout << std::format("  find, std::string:   {:7.1f} ns/op  {:5.2f} allocations/op\n",
+                             string_lookup.ms * 1e6 / lookups, string_lookup.allocations / lookups);
+    std::cout << std::format("  erase:               {:7.1f} ns/op  {:5.2f} allocations/op\n",
+                             erase.ms * 1e6 / n, erase.allocations / n);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (int key : bench::shuffledKeys(n))
+        keys.push_back(std::format("tenant/{:04}/object/{:010}/meta", key % 1000, key));
+    std::vector<std::string_view> probes(keys.begin(), keys.end());
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(5));
+
+    std::cout << std::format("n = {}, t = {}, keys of {} characters\n", n, Degree, keys.front().size());
+    run<BTreeMap<std::string, std::unique_ptr<Payload>, std::less<>, Degree>>("BTreeMap", keys, probes);
+    run<std::map<std::string, std::unique_ptr<Payload>, std::less<>>>("std::map", keys, probes);
+    return 0;
+}
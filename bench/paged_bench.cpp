@@ -0,0 +1,86 @@
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include "bench_util.h"
+#include "paged_tree.h"
+#include "tree.h"
+
+
+/*
+Paged tree benchmark: writes n random ints into a page file, then compares reopening the file with rebuilding an
+in-memory tree, and measures random lookups with cold caches (buffer pool and kernel page cache dropped) and warm,
+through a buffer pool of a given number of 4 KiB pages and through a read-only mapping.
+The file is written through a larger pool: dirty pages are only written back by a flush, so a small pool under
+random insertions flushes every few hundred of them.
+Usage: paged_bench [n] [lookups] [pool pages] [file]
+*/
+using Tree = PagedBTree<int>;
+constexpr size_t WritePoolPages = 1 << 14;
+
+template <typename Lookup>
+double lookupsUs(const std::vector<int>& probes, Lookup lookup)
+{
+    size_t found = 0;
+    bench::Timer timer;
+    for (int key : probes)
+        found += lookup(key);
+    double ms = timer.elapsedMs();
+    if (found != probes.size())
+        throw std::runtime_error("A stored key was not found");
+    return ms * 1e3 / probes.size();
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    size_t lookups = bench::parseCount(argc, argv, 2, 20'000);
+    size_t pool_pages = bench::parseCount(argc, argv, 3, 256);
+    std::string path = argc > 4 ? argv[4] : "paged_bench.db";
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".journal");
+
+    std::vector<int> keys = bench::shuffledKeys(n);
+    std::vector<int> probes(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(std::min(lookups, n)));
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(9));
+
+    bench::Timer write_timer;
+    {
+        Tree tree(path, WritePoolPages);
+        for (int key : keys)
+            tree.insert(key);
+        tree.flush();
+    }
+    double write_ms = write_timer.elapsedMs();
+
+    bench::Timer rebuild_timer;
+    {
+        BTree<int, Tree::Degree> memory;
+        for (int key : keys)
+            memory.insert(key);
+    }
+    double rebuild_ms = rebuild_timer.elapsedMs();
+
+    bench::Timer open_timer;
+    Tree tree(path, pool_pages, paged::OpenMode::ReadOnly);
+    double open_ms = open_timer.elapsedMs();
+
+    tree.dropCaches();
+    double cold_us = lookupsUs(probes, [&](int key) { return tree.count(key); });
+    double warm_us = lookupsUs(probes, [&](int key) { return tree.count(key); });
+
+    tree.dropCaches();
+    Tree mapped(path, 0, paged::OpenMode::ReadOnlyMapped);
+    double mapped_cold_us = lookupsUs(probes, [&](int key) { return mapped.count(key); });
+    double mapped_warm_us = lookupsUs(probes, [&](int key) { return mapped.count(key); });
+
+    std::cout << std::format("n = {}, t = {}, 4 KiB pages, file {:.1f} MiB, buffer pool {} pages\n", n, Tree::Degree,
+                             std::filesystem::file_size(path) / (1024.0 * 1024.0), pool_pages);
+    std::cout << std::format("write and flush:        {:9.1f} ms\n", write_ms);
+    std::cout << std::format("rebuild in memory:      {:9.1f} ms\n", rebuild_ms);
+    std::cout << std::format("open the file:          {:9.3f} ms\n", open_ms);
+    std::cout << std::format("lookup, pool, cold:     {:9.2f} us\n", cold_us);
+    std::cout << std::format("lookup, pool, warm:     {:9.2f} us\n", warm_us);
+    std::cout << std::format("lookup, mapped, cold:   {:9.2f} us\n", mapped_cold_us);
+    std::cout << std::format("lookup, mapped, warm:   {:9.2f} us\n", mapped_warm_us);
+    return 0;
+}
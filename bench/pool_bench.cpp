@@ -0,0 +1,69 @@
+#include <format>
+#include <iostream>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Node storage benchmark: inserts, finds and removes n distinct keys in random order
+and reports the time, the allocator calls and the peak heap footprint of the tree.
+Usage: pool_bench [n] [t], t is one of 2, 4, 8, 16, 32, 64
+*/
+template <size_t t>
+void run(const std::vector<int>& keys)
+{
+    size_t n = keys.size();
+    bench::resetPeak();
+    bench::AllocationSnapshot before = bench::allocationSnapshot();
+
+    BTree<int, t> tree;
+
+    bench::Timer insert_timer;
+    for (int key : keys)
+        tree.insert(key);
+    double insert_ms = insert_timer.elapsedMs();
+    bench::AllocationSnapshot after_insert = bench::allocationSnapshot();
+
+    bench::Timer find_timer;
+    size_t found = 0;
+    for (int key : keys)
+        found += tree.find(key).first != nullptr;
+    double find_ms = find_timer.elapsedMs();
+
+    bench::Timer remove_timer;
+    for (int key : keys)
+        tree.remove(key);
+    double remove_ms = remove_timer.elapsedMs();
+    bench::AllocationSnapshot after_remove = bench::allocationSnapshot();
+
+    std::cout << std::format("n = {}, t = {}, found = {}\n", n, t, found);
+    std::cout << std::format("insert: {:10.1f} ms ({:.1f} ns/op)\n", insert_ms, insert_ms * 1e6 / n);
+    std::cout << std::format("find:   {:10.1f} ms ({:.1f} ns/op)\n", find_ms, find_ms * 1e6 / n);
+    std::cout << std::format("remove: {:10.1f} ms ({:.1f} ns/op)\n", remove_ms, remove_ms * 1e6 / n);
+    std::cout << std::format("allocator calls: {} during inserts, {} in total\n",
+                             after_insert.calls - before.calls, after_remove.calls - before.calls);
+    std::cout << std::format("peak heap: {:.1f} MiB ({:.1f} bytes/key)\n",
+                             after_insert.peak_live / (1024.0 * 1024.0),
+                             static_cast<double>(after_insert.peak_live) / n);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    size_t t = bench::parseCount(argc, argv, 2, 8);
+    std::vector<int> keys = bench::shuffledKeys(n);
+
+    switch (t)
+    {
+    case 2: run<2>(keys); break;
+    case 4: run<4>(keys); break;
+    case 8: run<8>(keys); break;
+    case 16: run<16>(keys); break;
+    case 32: run<32>(keys); break;
+    case 64: run<64>(keys); break;
+    default:
+        std::cerr << std::format("unsupported t = {}\n", t);
+        return 1;
+    }
+    return 0;
+}
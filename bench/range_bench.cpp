@@ -0,0 +1,49 @@
+#include <format>
+#include <iostream>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Range scan benchmark: counts the values in random windows [lo, lo + width) of a tree of n distinct ints,
+once with a find per key of the window and once with a single range() scan.
+Usage: range_bench [n] [width] [queries]
+*/
+constexpr size_t Degree = 16;
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    size_t width = bench::parseCount(argc, argv, 2, 1000);
+    size_t queries = bench::parseCount(argc, argv, 3, 2000);
+
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    BTree<int, Degree> tree(keys.begin(), keys.end(), 0.75);
+
+    std::mt19937 rng(11);
+    std::vector<int> starts(queries);
+    for (int& start : starts)
+        start = static_cast<int>(rng() % n);
+
+    size_t per_key_total = 0;
+    bench::Timer per_key_timer;
+    for (int lo : starts)
+        for (int key = lo; key < lo + static_cast<int>(width); key++)
+            per_key_total += tree.find(key).first != nullptr;
+    double per_key_ms = per_key_timer.elapsedMs();
+
+    size_t scan_total = 0;
+    bench::Timer scan_timer;
+    for (int lo : starts)
+        for ([[maybe_unused]] int key : tree.range(lo, lo + static_cast<int>(width) - 1))
+            scan_total++;
+    double scan_ms = scan_timer.elapsedMs();
+
+    std::cout << std::format("n = {}, t = {}, {} windows of {} keys\n", n, Degree, queries, width);
+    std::cout << std::format("find per key: {:8.1f} ms ({:.1f} ns/value), {} values\n", per_key_ms,
+                             per_key_ms * 1e6 / per_key_total, per_key_total);
+    std::cout << std::format("range scan:   {:8.1f} ms ({:.1f} ns/value), {} values\n", scan_ms,
+                             scan_ms * 1e6 / scan_total, scan_total);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <format>
+#include <iostream>
+#include <iterator>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Order statistics benchmark: the cost of keeping subtree sizes during n random insertions, and percentile and
+range count queries answered with select and countRange against walking the iterators of a plain tree.
+Usage: rank_bench [n] [queries]
+*/
+constexpr size_t Degree = 16;
+
+template <typename Tree>
+double insertAll(Tree& tree, const std::vector<int>& keys)
+{
+    bench::Timer timer;
+    for (int key : keys)
+        tree.insert(key);
+    return timer.elapsedMs();
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    size_t queries = bench::parseCount(argc, argv, 2, 200);
+    std::vector<int> keys = bench::shuffledKeys(n);
+
+    BTree<int, Degree> plain;
+    BTree<int, Degree, true> ranked;
+    double plain_insert_ms = insertAll(plain, keys);
+    double ranked_insert_ms = insertAll(ranked, keys);
+    std::cout << std::format("n = {}, t = {}\n", n, Degree);
+    std::cout << std::format("insert, plain:   {:8.1f} ms ({:.1f} ns/key)\n", plain_insert_ms, plain_insert_ms * 1e6 / n);
+    std::cout << std::format("insert, ranked:  {:8.1f} ms ({:.1f} ns/key)\n", ranked_insert_ms, ranked_insert_ms * 1e6 / n);
+
+    // the p1 .. p99 percentiles, once by stepping an iterator from begin() and once with select
+    size_t walk_sum = 0;
+    bench::Timer walk_timer;
+    for (size_t q = 0; q < queries; q++)
+        walk_sum += *std::next(plain.begin(), static_cast<std::ptrdiff_t>(n * (q % 99 + 1) / 100));
+    double walk_ms = walk_timer.elapsedMs();
+
+    size_t select_sum = 0;
+    bench::Timer select_timer;
+    for (size_t q = 0; q < queries; q++)
+        select_sum += *ranked.select(n * (q % 99 + 1) / 100);
+    double select_ms = select_timer.elapsedMs();
+
+    std::mt19937 rng(5);
+    size_t range_walk = 0;
+    size_t range_count = 0;
+    bench::Timer range_walk_timer;
+    for (size_t q = 0; q < queries; q++)
+    {
+        int lo = static_cast<int>(rng() % n);
+        auto window = plain.range(lo, lo + static_cast<int>(n / 10));
+        range_walk += static_cast<size_t>(std::distance(window.begin(), window.end()));
+    }
+    double range_walk_ms = range_walk_timer.elapsedMs();
+    rng.seed(5);
+    bench::Timer range_count_timer;
+    for (size_t q = 0; q < queries; q++)
+    {
+        int lo = static_cast<int>(rng() % n);
+        range_count += ranked.countRange(lo, lo + static_cast<int>(n / 10));
+    }
+    double range_count_ms = range_count_timer.elapsedMs();
+
+    std::cout << std::format("percentile, walk:   {:10.3f} ms/query\n", walk_ms / queries);
+    std::cout << std::format("percentile, select: {:10.3f} ms/query\n", select_ms / queries);
+    std::cout << std::format("n/10 range, walk:   {:10.3f} ms/query\n", range_walk_ms / queries);
+    std::cout << std::format("n/10 range, count:  {:10.3f} ms/query\n", range_count_ms / queries);
+    if (walk_sum != select_sum || range_walk != range_count)
+    {
+        std::cout << "ERROR: the answers differ\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <format>
+#include <iostream>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Point lookup benchmark for the node layout and the in-node search.
+First times std::lower_bound against node_search::lowerBound on a single node worth of sorted keys,
+then times random successful finds in a tree of n distinct ints for several t.
+Usage: search_bench [n] [lookups]
+*/
+template <size_t Capacity>
+void runKernel(std::mt19937& rng)
+{
+    constexpr size_t Searches = 10'000'000;
+    alignas(CacheLineSize) std::array<int, node_search::PaddedCapacity<int, Capacity>> keys{};
+    for (size_t i = 0; i < Capacity; i++)
+        keys[i] = static_cast<int>(2 * i);
+    std::vector<int> needles(4096);
+    for (int& needle : needles)
+        needle = static_cast<int>(rng() % (2 * Capacity + 1));
+
+    size_t checksum = 0;
+    bench::Timer std_timer;
+    for (size_t i = 0; i < Searches; i++)
+        checksum += std::lower_bound(keys.begin(), keys.begin() + Capacity, needles[i & 4095]) - keys.begin();
+    double std_ms = std_timer.elapsedMs();
+
+    bench::Timer node_timer;
+    for (size_t i = 0; i < Searches; i++)
+        checksum -= node_search::lowerBound(keys.data(), Capacity, needles[i & 4095]);
+    double node_ms = node_timer.elapsedMs();
+
+    std::cout << std::format("{:>4} keys: std::lower_bound {:6.2f} ns, node search {:6.2f} ns{}\n", Capacity,
+                             std_ms * 1e6 / Searches, node_ms * 1e6 / Searches, checksum ? " (MISMATCH)" : "");
+}
+
+template <size_t t>
+void runTree(const std::vector<int>& keys, const std::vector<int>& lookups)
+{
+    BTree<int, t> tree;
+    for (int key : keys)
+        tree.insert(key);
+
+    size_t found = 0;
+    bench::Timer timer;
+    for (int key : lookups)
+        found += tree.find(key).first != nullptr;
+    double ms = timer.elapsedMs();
+    std::cout << std::format("t = {:>2}: {:7.1f} ns/lookup ({} found)\n", t, ms * 1e6 / lookups.size(), found);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    size_t lookup_count = bench::parseCount(argc, argv, 2, 2'000'000);
+    std::mt19937 rng(7);
+
+    std::cout << std::format("in-node search, {}-byte vectors\n", node_search::VectorBytes);
+    runKernel<7>(rng);
+    runKernel<15>(rng);
+    runKernel<31>(rng);
+    runKernel<63>(rng);
+    runKernel<127>(rng);
+
+    std::vector<int> keys = bench::shuffledKeys(n);
+    std::vector<int> lookups(lookup_count);
+    for (int& key : lookups)
+        key = keys[rng() % n];
+
+    std::cout << std::format("tree lookups, n = {}\n", n);
+    runTree<4>(keys, lookups);
+    runTree<8>(keys, lookups);
+    runTree<16>(keys, lookups);
+    runTree<32>(keys, lookups);
+    runTree<64>(keys, lookups);
+    return 0;
+}
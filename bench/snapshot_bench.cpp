@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include "bench_util.h"
+#include "persistent_tree.h"
+#include "tree.h"
+
+
+/*
+Snapshot benchmark: the write overhead of path copying. n random insertions and the removal of every key, timed on
+a BTree updated in place and on a PersistentBTree that holds no snapshot, one snapshot renewed every 1024 updates
+and one renewed after every update, which copies the whole path of each write. With snapshots on, the one taken
+after the insertions is also kept through the removals and scanned at the end, it must still hold every key.
+Usage: snapshot_bench [n]
+*/
+constexpr size_t Degree = 16;
+
+struct Phase
+{
+    double ms;
+    size_t allocations;
+};
+
+struct Timings
+{
+    Phase insert;
+    Phase remove;
+};
+
+template <typename Operation>
+Phase measure(Operation operation)
+{
+    size_t calls_before = bench::allocationSnapshot().calls;
+    bench::Timer timer;
+    operation();
+    double ms = timer.elapsedMs();
+    return { ms, bench::allocationSnapshot().calls - calls_before };
+}
+
+Timings runInPlace(const std::vector<int>& keys, const std::vector<int>& removals)
+{
+    BTree<int, Degree, false, Restructuring::TopDown> tree;
+    Timings timings{};
+    timings.insert = measure([&]
+    {
+        for (int key : keys)
+            tree.insert(key);
+    });
+    timings.remove = measure([&]
+    {
+        for (int key : removals)
+            tree.remove(key);
+    });
+    return timings;
+}
+
+// snapshot_every == 0 takes no snapshot during the updates
+Timings runPersistent(const std::vector<int>& keys, const std::vector<int>& removals, size_t snapshot_every)
+{
+    using Tree = PersistentBTree<int, Degree>;
+    Tree tree;
+    std::optional<Tree::Snapshot> held;
+    size_t updates = 0;
+    auto afterUpdate = [&]
+    {
+        if (snapshot_every && ++updates % snapshot_every == 0)
+            held = tree.snapshot();
+    };
+
+    Timings timings{};
+    timings.insert = measure([&]
+    {
+        for (int key : keys)
+        {
+            tree.insert(key);
+            afterUpdate();
+        }
+    });
+    Tree::Snapshot full = snapshot_every ? tree.snapshot() : Tree::Snapshot();
+    timings.remove = measure([&]
+    {
+        for (int key : removals)
+        {
+            tree.remove(key);
+            afterUpdate();
+        }
+    });
+    held.reset();
+
+    if (tree.size() != 0)
+        throw std::runtime_error("Values are left after removing all of them");
+    if (snapshot_every && (full.size() != keys.size() || !std::is_sorted(full.begin(), full.end())
+                           || static_cast<size_t>(std::distance(full.begin(), full.end())) != keys.size()))
+        throw std::runtime_error("A snapshot changed after it was taken");
+    return timings;
+}
+
+void report(const char* name, const Timings& timings, double n)
+{
+    std::cout << std::format("{:<28} insert: {:7.1f} ns/op {:5.2f} allocations/op    remove: {:7.1f} ns/op {:5.2f} allocations/op\n",
+                             name, timings.insert.ms * 1e6 / n, timings.insert.allocations / n,
+                             timings.remove.ms * 1e6 / n, timings.remove.allocations / n);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    std::vector<int> keys = bench::shuffledKeys(n);
+    std::vector<int> removals = bench::shuffledKeys(n, 7);
+    double count = static_cast<double>(n);
+
+    std::cout << std::format("n = {}, t = {}\n", n, Degree);
+    report("BTree, in place", runInPlace(keys, removals), count);
+    report("PersistentBTree, no snapshot", runPersistent(keys, removals, 0), count);
+    report("snapshot every 1024 updates", runPersistent(keys, removals, 1024), count);
+    report("snapshot every update", runPersistent(keys, removals, 1), count);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Restructuring benchmark: the same write-heavy workload run on a bottom-up and a top-down tree of the same degree,
+n random insertions, then n mixed insertions and removals, then the removal of everything left.
+The contents of both trees are taken after every phase, outside the timings, and the run fails if they differ.
+Usage: top_down_bench [n]
+*/
+struct Timings
+{
+    double insert_ms;
+    double mixed_ms;
+    double drain_ms;
+};
+
+template <typename Tree>
+Timings runWorkload(Tree& tree, const std::vector<int>& keys, const std::vector<int>& mixed,
+                    std::vector<std::vector<int>>& phase_contents)
+{
+    Timings timings{};
+    bench::Timer insert_timer;
+    for (int key : keys)
+        tree.insert(key);
+    timings.insert_ms = insert_timer.elapsedMs();
+    phase_contents.emplace_back(tree.begin(), tree.end());
+
+    // a key k >= 0 of the mixed sequence is inserted, a negative one removes -k - 1
+    bench::Timer mixed_timer;
+    for (int key : mixed)
+    {
+        if (key >= 0)
+            tree.insert(key);
+        else
+            tree.remove(-key - 1);
+    }
+    timings.mixed_ms = mixed_timer.elapsedMs();
+    phase_contents.emplace_back(tree.begin(), tree.end());
+
+    std::vector<int> rest = phase_contents.back();
+    std::shuffle(rest.begin(), rest.end(), std::mt19937(3));
+    bench::Timer drain_timer;
+    for (int key : rest)
+        tree.remove(key);
+    timings.drain_ms = drain_timer.elapsedMs();
+    phase_contents.emplace_back(tree.begin(), tree.end());
+    if (!phase_contents.back().empty())
+        throw std::runtime_error("Values are left after removing all of them");
+    return timings;
+}
+
+template <size_t t>
+bool compare(const std::vector<int>& keys, const std::vector<int>& mixed)
+{
+    BTree<int, t> bottom_up;
+    BTree<int, t, false, Restructuring::TopDown> top_down;
+    std::vector<std::vector<int>> bottom_up_contents;
+    std::vector<std::vector<int>> top_down_contents;
+    Timings bottom_up_ms = runWorkload(bottom_up, keys, mixed, bottom_up_contents);
+    Timings top_down_ms = runWorkload(top_down, keys, mixed, top_down_contents);
+
+    double n = static_cast<double>(keys.size());
+    std::cout << std::format("t = {}\n", t);
+    std::cout << std::format("insert, bottom-up:  {:8.1f} ns/op    top-down: {:8.1f} ns/op\n",
+                             bottom_up_ms.insert_ms * 1e6 / n, top_down_ms.insert_ms * 1e6 / n);
+    std::cout << std::format("mixed, bottom-up:   {:8.1f} ns/op    top-down: {:8.1f} ns/op\n",
+                             bottom_up_ms.mixed_ms * 1e6 / mixed.size(), top_down_ms.mixed_ms * 1e6 / mixed.size());
+    std::cout << std::format("remove, bottom-up:  {:8.1f} ns/op    top-down: {:8.1f} ns/op\n",
+                             bottom_up_ms.drain_ms * 1e6 / bottom_up_contents[1].size(),
+                             top_down_ms.drain_ms * 1e6 / top_down_contents[1].size());
+    const char* phases[] = { "insert", "mixed", "remove" };
+    for (size_t phase = 0; phase < std::size(phases); phase++)
+    {
+        if (bottom_up_contents[phase] != top_down_contents[phase])
+        {
+            std::cout << std::format("ERROR: the trees differ after the {} phase\n", phases[phase]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 1'000'000);
+    std::vector<int> keys = bench::shuffledKeys(n);
+
+    // n new keys above the first phase, interleaved with the removal of half of the keys inserted there
+    std::vector<int> mixed;
+    mixed.reserve(n + n / 2);
+    for (size_t i = 0; i < n; i++)
+        mixed.push_back(static_cast<int>(n + i));
+    for (size_t i = 0; i < n / 2; i++)
+        mixed.push_back(-keys[i] - 1);
+    std::shuffle(mixed.begin(), mixed.end(), std::mt19937(7));
+
+    std::cout << std::format("n = {}\n", n);
+    bool same = compare<8>(keys, mixed) && compare<32>(keys, mixed) && compare<128>(keys, mixed);
+    return same ? 0 : 1;
+}
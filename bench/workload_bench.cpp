@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "bench_util.h"
+#include "tree.h"
+
+
+/*
+Workload suite: BTree over a sweep of t against std::set, or std::multiset where the keys repeat.
+Every workload inserts n keys, looks n keys up and removes every inserted key again:
+    sequential  the keys 0..n-1 in ascending order, for all three phases
+    random      the same keys, every phase in its own random order
+    zipfian     n draws with s = 0.99 over n keys whose ranks are scattered over the key space, the lookups are new
+                draws and the removals the inserted draws shuffled
+    duplicates  n uniform draws from n / 64 keys, so every key repeats about 64 times
+Every phase reports its throughput and the p50 and p99 latency of single operations. The operations are timed one
+by one, so the throughput includes those clock reads. Memory is what the container holds from operator new after
+the insertions, per inserted value, without the overhead of the allocator.
+Built with BTREE_ENABLE_STATS the trees also report their shape and the nodes and restructurings each phase cost.
+Usage: workload_bench [n]
+*/
+struct Workload
+{
+    std::string name;
+    std::vector<int> inserts;
+    std::vector<int> finds;
+    std::vector<int> removals;
+    bool repeats;
+};
+
+struct Phase
+{
+    double mops;
+    int64_t p50_ns;
+    int64_t p99_ns;
+};
+
+struct Result
+{
+    Phase insert;
+    Phase find;
+    Phase remove;
+    double bytes_per_value;
+    size_t found;
+};
+
+template <size_t t>
+class TreeUnderTest
+{
+    BTree<int, t> tree;
+    std::string stats_line;
+
+public:
+    static std::string name()
+    {
+        return std::format("BTree, t = {}", t);
+    }
+    void insert(int key)
+    {
+        this->tree.insert(key);
+    }
+    bool find(int key)
+    {
+        return this->tree.find(key).first != nullptr;
+    }
+    void remove(int key)
+    {
+        this->tree.remove(key);
+    }
+    bool empty()const
+    {
+        return this->tree.begin() == this->tree.end();
+    }
+    // what the phase that just ended cost the tree, collected with BTREE_ENABLE_STATS only
+    void endPhase(const char* phase, [[maybe_unused]] OperationCounts TreeStats::* calls)
+    {
+        if constexpr (StatsEnabled)
+        {
+            TreeStats stats = this->tree.stats();
+            const RestructuringCounts& steps = stats.restructurings;
+            if (this->stats_line.empty())
+                this->stats_line = std::format("    height {}, {} nodes, fill {:.2f}", stats.height, stats.nodes,
+                                               stats.fill_factor);
+            this->stats_line += std::format("\n    {:<6} {:5.2f} nodes/op, splits {} + {} root, rotations {} left {} right,"
+                                            " merges {} left {} right", phase, (stats.*calls).nodesVisitedPerCall(),
+                                            steps.split, steps.split_root, steps.rotate_left, steps.rotate_right,
+                                            steps.merge_with_left, steps.merge_with_right);
+            this->tree.resetStats();
+        }
+    }
+    const std::string& statsLine()const
+    {
+        return this->stats_line;
+    }
+};
+
+template <typename Set>
+class SetUnderTest
+{
+    Set set;
+    std::string stats_line;
+
+public:
+    static std::string name()
+    {
+        return std::is_same_v<Set, std::set<int>> ? "std::set" : "std::multiset";
+    }
+    void insert(int key)
+    {
+        this->set.insert(key);
+    }
+    bool find(int key)
+    {
+        return this->set.find(key) != this->set.end();
+    }
+    void remove(int key)
+    {
+        this->set.erase(this->set.find(key)); // one copy, as BTree::remove
+    }
+    bool empty()const
+    {
+        return this->set.empty();
+    }
+    void endPhase(const char*, OperationCounts TreeStats::*) {}
+    const std::string& statsLine()const
+    {
+        return this->stats_line;
+    }
+};
+
+template <typename Operation>
+Phase timePhase(const std::vector<int>& keys, std::vector<int64_t>& latencies, Operation operation)
+{
+    bench::Timer timer;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        operation(keys[i]);
+        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    double ms = timer.elapsedMs();
+
+    auto percentile = [&](double share)
+    {
+        auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(share * static_cast<double>(keys.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.begin() + static_cast<std::ptrdiff_t>(keys.size()));
+        return *nth;
+    };
+    return { static_cast<double>(keys.size()) / ms / 1e3, percentile(0.5), percentile(0.99) };
+}
+
+// latencies is sized for the longest phase up front, so it does not count towards the memory of the container
+template <typename Container>
+Result run(const Workload& workload, std::vector<int64_t>& latencies)
+{
+    Result result{};
+    size_t live_before = bench::allocationSnapshot().live;
+    Container container;
+    result.insert = timePhase(workload.inserts, latencies, [&](int key) { container.insert(key); });
+    result.bytes_per_value = static_cast<double>(bench::allocationSnapshot().live - live_before) / workload.inserts.size();
+    container.endPhase("insert", &TreeStats::insert);
+    result.find = timePhase(workload.finds, latencies, [&](int key) { result.found += container.find(key); });
+    container.endPhase("find", &TreeStats::find);
+    result.remove = timePhase(workload.removals, latencies, [&](int key) { container.remove(key); });
+    container.endPhase("remove", &TreeStats::remove);
+    if (!container.empty())
+        throw std::runtime_error(std::format("{} keeps values after removing all of them", Container::name()));
+
+    auto column = [](const Phase& phase)
+    {
+        return std::format("{:7.2f} {:6} {:7}", phase.mops, phase.p50_ns, phase.p99_ns);
+    };
+    std::cout << std::format("{:<16}{}   {}   {}   {:8.1f}\n", Container::name(), column(result.insert),
+                             column(result.find), column(result.remove), result.bytes_per_value);
+    if (!container.statsLine().empty())
+        std::cout << container.statsLine() << "\n";
+    return result;
+}
+
+template <size_t... Degrees>
+void runWorkload(const Workload& workload, std::vector<int64_t>& latencies)
+{
+    std::cout << std::format("\n{}: {} insertions, {} lookups, {} removals\n", workload.name, workload.inserts.size(),
+                             workload.finds.size(), workload.removals.size());
+    std::cout << std::format("{:<16}{:^22}   {:^22}   {:^22}   {:>8}\n", "", "insert", "find", "remove", "memory");
+    std::string header = std::format("{:>7} {:>6} {:>7}", "Mops/s", "p50 ns", "p99 ns");
+    std::cout << std::format("{:<16}{}   {}   {}   {:>8}\n", "", header, header, header, "B/value");
+
+    size_t expected = workload.repeats ? run<SetUnderTest<std::multiset<int>>>(workload, latencies).found
+                                       : run<SetUnderTest<std::set<int>>>(workload, latencies).found;
+    bool same = true;
+    ((same &= run<TreeUnderTest<Degrees>>(workload, latencies).found == expected), ...);
+    if (!same)
+        throw std::runtime_error(std::format("The containers disagree on the lookups of the {} workload", workload.name));
+}
+
+// count draws from a Zipfian distribution over n keys, the most frequent ones spread over 0..n-1 at random
+std::vector<int> zipfianKeys(size_t n, size_t count, unsigned seed)
+{
+    constexpr double Skew = 0.99;
+    std::vector<double> cumulative(n);
+    double total = 0;
+    for (size_t rank = 0; rank < n; rank++)
+    {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), Skew);
+        cumulative[rank] = total;
+    }
+    std::vector<int> keys_by_rank = bench::shuffledKeys(n, 11);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> draw(0.0, total);
+    std::vector<int> keys(count);
+    for (int& key : keys)
+    {
+        size_t rank = std::lower_bound(cumulative.begin(), cumulative.end(), draw(rng)) - cumulative.begin();
+        key = keys_by_rank[std::min(rank, n - 1)];
+    }
+    return keys;
+}
+
+std::vector<int> shuffled(std::vector<int> keys, unsigned seed)
+{
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+    return keys;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = bench::parseCount(argc, argv, 1, 500'000);
+    std::vector<int64_t> latencies(n);
+
+    std::vector<int> sequential(n);
+    std::iota(sequential.begin(), sequential.end(), 0);
+    std::vector<int> zipfian = zipfianKeys(n, n, 1);
+    std::vector<int> duplicates(n);
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> few_keys(0, static_cast<int>(std::max<size_t>(n / 64, 1)) - 1);
+    for (int& key : duplicates)
+        key = few_keys(rng);
+
+    std::vector<Workload> workloads;
+    workloads.push_back({ "sequential", sequential, sequential, sequential, false });
+    workloads.push_back({ "random", bench::shuffledKeys(n, 1), bench::shuffledKeys(n, 2), bench::shuffledKeys(n, 3), false });
+    workloads.push_back({ "zipfian", zipfian, zipfianKeys(n, n, 2), shuffled(zipfian, 4), true });
+    workloads.push_back({ "duplicates", duplicates, shuffled(duplicates, 5), shuffled(duplicates, 6), true });
+
+    std::cout << std::format("n = {}{}\n", n, StatsEnabled ? ", stats on" : "");
+    for (const Workload& workload : workloads)
+        runWorkload<4, 8, 16, 32, 64, 128>(workload, latencies);
+    return 0;
+}
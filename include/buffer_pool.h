@@ -0,0 +1,448 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "node_search.h"
+#include "page_file.h"
+
+
+namespace paged
+{
+    using PageId = uint64_t;
+    inline constexpr PageId NoPage = 0; // page 0 is the meta page, so no other page is ever referenced by id 0
+
+    enum class OpenMode
+    {
+        ReadWrite,
+        ReadOnly,
+        ReadOnlyMapped // pages are read straight from a memory mapping of the file, without the buffer pool
+    };
+
+    // FNV-1a, enough to tell a journal that was completely written from a torn one
+    inline uint64_t checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+}
+
+/*
+Bounded cache of the pages of one file.
+Pages are pinned while a PageGuard refers to them and are evicted with the CLOCK algorithm otherwise.
+Dirty pages stay in memory until flush(), which is the crash-safe point: the dirty pages and the meta page are
+first written to <file>.journal and synced, only then written in place. Opening the file again replays a complete
+journal, so after a crash the file holds the state of either the last or the one before the last flush.
+Freed pages are chained into a free list through their first bytes and handed out again by allocate().
+Page 0 keeps the bookkeeping of the pool followed by UserBytes for the owner of the pool.
+*/
+template <size_t PageSize>
+class BufferPool
+{
+public:
+    static constexpr size_t HeaderBytes = 64;
+    static constexpr size_t UserBytes = PageSize - HeaderBytes;
+    static constexpr size_t MinFrames = 16;
+
+private:
+    static constexpr uint64_t Magic = 0x31475045'45525442; // "BTREEPG1"
+    static constexpr uint64_t JournalMagic = 0x314c4e4a'45525442; // "BTREJNL1"
+    static constexpr size_t NoFrame = SIZE_MAX;
+
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t page_size;
+        uint64_t page_count;
+        paged::PageId free_head;
+    };
+    struct JournalHeader
+    {
+        uint64_t magic;
+        uint64_t page_size;
+        uint64_t pages;
+        uint64_t checksum; // over all the records, every record is a page id followed by the page
+    };
+    struct alignas(CacheLineSize) Page
+    {
+        std::array<std::byte, PageSize> bytes;
+    };
+    struct Frame
+    {
+        paged::PageId id;
+        uint32_t pins;
+        bool dirty;
+        bool referenced; // the second chance of CLOCK
+    };
+    static_assert(sizeof(Header) <= HeaderBytes);
+
+    PageFile file;
+    std::string journal_path;
+    paged::OpenMode mode;
+    const std::byte* mapping;
+    Page meta;
+    bool meta_dirty;
+    std::vector<Page> pages;
+    std::vector<Frame> frames;
+    std::unordered_map<paged::PageId, size_t> page_table;
+    size_t clock_hand;
+    size_t dirty_count;
+
+public:
+    class PageGuard
+    {
+        BufferPool* pool;
+        size_t frame;
+        std::byte* bytes;
+        paged::PageId id;
+    public:
+        PageGuard() : pool(nullptr), frame(NoFrame), bytes(nullptr), id(paged::NoPage) {}
+        PageGuard(BufferPool* pool, size_t frame, std::byte* bytes, paged::PageId id) :
+            pool(pool), frame(frame), bytes(bytes), id(id)
+        {
+        }
+        PageGuard(PageGuard&& other) noexcept : pool(std::exchange(other.pool, nullptr)), frame(other.frame),
+            bytes(other.bytes), id(other.id)
+        {
+        }
+        PageGuard& operator=(PageGuard&& other) noexcept
+        {
+            if (this != &other)
+            {
+                this->unpin();
+                this->pool = std::exchange(other.pool, nullptr);
+                this->frame = other.frame;
+                this->bytes = other.bytes;
+                this->id = other.id;
+            }
+            return *this;
+        }
+        PageGuard(const PageGuard& other) = delete;
+        PageGuard& operator=(const PageGuard& other) = delete;
+        ~PageGuard()
+        {
+            this->unpin();
+        }
+        paged::PageId getId()const
+        {
+            return this->id;
+        }
+        template <typename U>
+        const U* as()const
+        {
+            return reinterpret_cast<const U*>(this->bytes);
+        }
+        // writing access marks the page dirty
+        template <typename U>
+        U* asMutable()
+        {
+            this->pool->markDirty(this->frame);
+            return reinterpret_cast<U*>(this->bytes);
+        }
+    private:
+        void unpin()
+        {
+            if (this->pool && this->frame != NoFrame)
+                this->pool->frames[this->frame].pins--;
+            this->pool = nullptr;
+        }
+    };
+
+    BufferPool(const std::string& path, size_t frame_count, paged::OpenMode mode) :
+        file(path, mode != paged::OpenMode::ReadWrite),
+        journal_path(path + ".journal"),
+        mode(mode),
+        mapping(nullptr),
+        meta(),
+        meta_dirty(false),
+        pages(mode == paged::OpenMode::ReadOnlyMapped ? 0 : frame_count),
+        frames(this->pages.size(), Frame{ paged::NoPage, 0, false, false }),
+        page_table(),
+        clock_hand(0),
+        dirty_count(0)
+    {
+        if (mode != paged::OpenMode::ReadOnlyMapped && frame_count < MinFrames)
+            throw std::invalid_argument(std::format("A buffer pool needs at least {} frames, got {}", MinFrames, frame_count));
+
+        if (mode == paged::OpenMode::ReadWrite)
+            this->recover();
+        else if (this->pendingJournalPages() > 0)
+            throw std::runtime_error(std::format("{} was not flushed completely, open it writable once to recover it", path));
+
+        if (this->file.size() == 0)
+        {
+            if (mode != paged::OpenMode::ReadWrite)
+                throw std::runtime_error(std::format("{} is empty", path));
+            this->header() = Header{ Magic, PageSize, 1, paged::NoPage };
+            this->meta_dirty = true;
+        }
+        else
+        {
+            this->file.read(0, this->meta.bytes.data(), PageSize);
+            if (this->header().magic != Magic || this->header().page_size != PageSize)
+                throw std::runtime_error(std::format("{} is not a page file with {} byte pages", path, PageSize));
+        }
+        if (mode == paged::OpenMode::ReadOnlyMapped)
+            this->mapping = this->file.map();
+    }
+    BufferPool(BufferPool&& other) = delete;
+    BufferPool& operator=(BufferPool&& other) = delete;
+    BufferPool(const BufferPool& other) = delete;
+    BufferPool& operator=(const BufferPool& other) = delete;
+
+    PageGuard fetch(paged::PageId id)
+    {
+        if (id == paged::NoPage || id >= this->header().page_count)
+            throw std::out_of_range(std::format("Page {} is out of the file", id));
+        if (this->mapping)
+            return PageGuard(this, NoFrame, const_cast<std::byte*>(this->mapping) + id * PageSize, id);
+
+        if (auto it = this->page_table.find(id); it != this->page_table.end())
+        {
+            Frame& frame = this->frames[it->second];
+            frame.pins++;
+            frame.referenced = true;
+            return PageGuard(this, it->second, this->pages[it->second].bytes.data(), id);
+        }
+        size_t frame = this->victim();
+        this->file.read(id * PageSize, this->pages[frame].bytes.data(), PageSize);
+        return this->install(frame, id);
+    }
+    // a zeroed page, taken from the free list or appended to the file
+    PageGuard allocate()
+    {
+        this->requireWritable();
+        Header& header = this->header();
+        this->meta_dirty = true;
+        if (header.free_head != paged::NoPage)
+        {
+            PageGuard guard = this->fetch(header.free_head);
+            header.free_head = *guard.template as<paged::PageId>();
+            std::memset(guard.template asMutable<std::byte>(), 0, PageSize);
+            return guard;
+        }
+        paged::PageId id = header.page_count++;
+        size_t frame = this->victim();
+        std::memset(this->pages[frame].bytes.data(), 0, PageSize);
+        PageGuard guard = this->install(frame, id);
+        this->markDirty(frame);
+        return guard;
+    }
+    // the page must not be referenced any more, it is reused by a later allocate()
+    void release(paged::PageId id)
+    {
+        this->requireWritable();
+        PageGuard guard = this->fetch(id);
+        *guard.template asMutable<paged::PageId>() = this->header().free_head;
+        this->header().free_head = id;
+        this->meta_dirty = true;
+    }
+    void flush();
+
+    const std::byte* userArea()const
+    {
+        return this->meta.bytes.data() + HeaderBytes;
+    }
+    std::byte* mutableUserArea()
+    {
+        this->requireWritable();
+        this->meta_dirty = true;
+        return this->meta.bytes.data() + HeaderBytes;
+    }
+    bool isReadOnly()const
+    {
+        return this->mode != paged::OpenMode::ReadWrite;
+    }
+    size_t getDirtyCount()const
+    {
+        return this->dirty_count;
+    }
+    size_t getFrameCount()const
+    {
+        return this->frames.size();
+    }
+    uint64_t getPageCount()const
+    {
+        return this->header().page_count;
+    }
+    // benchmarks drop the cached pages of the pool and of the kernel to measure cold reads
+    void dropCaches()
+    {
+        for (size_t i = 0; i < this->frames.size(); i++)
+        {
+            if (this->frames[i].pins > 0 || this->frames[i].dirty || this->frames[i].id == paged::NoPage)
+                continue;
+            this->page_table.erase(this->frames[i].id);
+            this->frames[i] = Frame{ paged::NoPage, 0, false, false };
+        }
+        this->file.dropOsCache();
+    }
+
+private:
+    Header& header()
+    {
+        return *reinterpret_cast<Header*>(this->meta.bytes.data());
+    }
+    const Header& header()const
+    {
+        return *reinterpret_cast<const Header*>(this->meta.bytes.data());
+    }
+    void requireWritable()const
+    {
+        if (this->isReadOnly())
+            throw std::logic_error("The page file is opened read-only");
+    }
+    void markDirty(size_t frame)
+    {
+        this->requireWritable();
+        if (!this->frames[frame].dirty)
+        {
+            this->frames[frame].dirty = true;
+            this->dirty_count++;
+        }
+    }
+    PageGuard install(size_t frame, paged::PageId id)
+    {
+        this->frames[frame] = Frame{ id, 1, false, true };
+        this->page_table.emplace(id, frame);
+        return PageGuard(this, frame, this->pages[frame].bytes.data(), id);
+    }
+    // CLOCK: sweep over the frames, a referenced page gets a second chance, pinned and dirty pages are skipped
+    size_t victim()
+    {
+        for (size_t step = 0; step < 2 * this->frames.size(); step++)
+        {
+            size_t index = this->clock_hand;
+            this->clock_hand = (this->clock_hand + 1) % this->frames.size();
+            Frame& frame = this->frames[index];
+            if (frame.pins > 0 || frame.dirty)
+                continue;
+            if (frame.referenced)
+            {
+                frame.referenced = false;
+                continue;
+            }
+            if (frame.id != paged::NoPage)
+                this->page_table.erase(frame.id);
+            frame.id = paged::NoPage;
+            return index;
+        }
+        throw std::runtime_error("Every frame of the buffer pool is pinned or dirty, flush or use more frames");
+    }
+    // pages of a journal that was completely written, 0 if there is none or the writer crashed while writing it
+    uint64_t journalPages(const PageFile& journal)const;
+    uint64_t pendingJournalPages()const
+    {
+        if (!std::filesystem::exists(this->journal_path))
+            return 0;
+        PageFile journal(this->journal_path, true);
+        return this->journalPages(journal);
+    }
+    void recover();
+};
+
+template <size_t PageSize>
+uint64_t BufferPool<PageSize>::journalPages(const PageFile& journal)const
+{
+    uint64_t size = journal.size();
+    JournalHeader header{};
+    if (size < sizeof(JournalHeader))
+        return 0;
+    journal.read(0, &header, sizeof(JournalHeader));
+    if (header.magic != JournalMagic || header.page_size != PageSize ||
+        (size - sizeof(JournalHeader)) / (sizeof(paged::PageId) + PageSize) < header.pages)
+        return 0;
+
+    uint64_t hash = paged::checksum(nullptr, 0);
+    Page page;
+    for (uint64_t i = 0; i < header.pages; i++)
+    {
+        paged::PageId id;
+        uint64_t offset = sizeof(JournalHeader) + i * (sizeof(paged::PageId) + PageSize);
+        journal.read(offset, &id, sizeof(id));
+        journal.read(offset + sizeof(id), page.bytes.data(), PageSize);
+        hash = paged::checksum(&id, sizeof(id), hash);
+        hash = paged::checksum(page.bytes.data(), PageSize, hash);
+    }
+    return hash == header.checksum ? header.pages : 0;
+}
+
+template <size_t PageSize>
+void BufferPool<PageSize>::recover()
+{
+    if (!std::filesystem::exists(this->journal_path))
+        return;
+    PageFile journal(this->journal_path, false);
+    uint64_t pages = this->journalPages(journal);
+    if (pages > 0)
+    {
+        // the journal was synced before any page was written in place, so writing all of it again completes the flush
+        Page page;
+        for (uint64_t i = 0; i < pages; i++)
+        {
+            paged::PageId id;
+            uint64_t offset = sizeof(JournalHeader) + i * (sizeof(paged::PageId) + PageSize);
+            journal.read(offset, &id, sizeof(id));
+            journal.read(offset + sizeof(id), page.bytes.data(), PageSize);
+            this->file.write(id * PageSize, page.bytes.data(), PageSize);
+        }
+        this->file.sync();
+    }
+    journal.resize(0);
+    journal.sync();
+}
+
+template <size_t PageSize>
+void BufferPool<PageSize>::flush()
+{
+    if (this->isReadOnly() || (this->dirty_count == 0 && !this->meta_dirty))
+        return;
+
+    std::vector<size_t> dirty;
+    dirty.reserve(this->dirty_count);
+    for (size_t i = 0; i < this->frames.size(); i++)
+        if (this->frames[i].dirty)
+            dirty.push_back(i);
+
+    // the journal gets every dirty page and the meta page, and must be durable before the file is touched
+    PageFile journal(this->journal_path, false);
+    uint64_t hash = paged::checksum(nullptr, 0);
+    uint64_t offset = sizeof(JournalHeader);
+    auto record = [&](paged::PageId id, const std::byte* bytes)
+    {
+        journal.write(offset, &id, sizeof(id));
+        journal.write(offset + sizeof(id), bytes, PageSize);
+        hash = paged::checksum(&id, sizeof(id), hash);
+        hash = paged::checksum(bytes, PageSize, hash);
+        offset += sizeof(id) + PageSize;
+    };
+    for (size_t frame : dirty)
+        record(this->frames[frame].id, this->pages[frame].bytes.data());
+    record(0, this->meta.bytes.data());
+    JournalHeader header{ JournalMagic, PageSize, dirty.size() + 1, hash };
+    journal.write(0, &header, sizeof(header));
+    journal.sync();
+
+    for (size_t frame : dirty)
+        this->file.write(this->frames[frame].id * PageSize, this->pages[frame].bytes.data(), PageSize);
+    this->file.write(0, this->meta.bytes.data(), PageSize);
+    this->file.sync();
+
+    journal.resize(0);
+    journal.sync();
+    for (size_t frame : dirty)
+        this->frames[frame].dirty = false;
+    this->dirty_count = 0;
+    this->meta_dirty = false;
+}
+#endif
@@ -0,0 +1,136 @@
+#ifndef CONCURRENT_TREE_H
+#define CONCURRENT_TREE_H
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "epoch.h"
+#include "node_search.h"
+#include "optimistic_latch.h"
+
+/*
+B-tree shared by any number of reader and writer threads, synchronized with optimistic lock coupling.
+Values live in the leaves only (a B+ tree), inner nodes hold separators: every value of child i is not greater
+than separator i and greater than separator i - 1. Every node carries a version latch. Lookups take no lock at all,
+they read a node, validate its version and restart from the root if a writer got in between. Writers read the same
+way and lock only the nodes they change: splits of full nodes on the way down of an insert and merges or borrows
+of minimal nodes on the way down of a remove happen eagerly, so an update never has to climb back up.
+Unlinked nodes are handed to epoch based reclamation since optimistic readers may still be inside them.
+As in BTree a repeated value is kept once with a duplicate count.
+
+The optimistic reads are data races by the letter of the memory model: count, keys, duplicate counts and child
+pointers are plain fields a reader loads while a writer may be storing them, and anything torn is thrown away when
+the version check fails. Atomic fields would keep the node search from using vector loads, so the tree accepts the
+race, which is harmless on the supported compilers and hardware for the trivially copyable values it allows.
+ThreadSanitizer reports it and does not model the fences of OptimisticLatch either, tests/tsan.supp suppresses the
+optimistic paths; tests/concurrent_stress_test.cpp checks the results under contention instead.
+*/
+template <typename T, size_t t>
+class ConcurrentBTree
+{
+    static constexpr size_t MinDegree = 2;
+    static_assert(t >= MinDegree, "t value must be at least 2");
+    // optimistic readers copy and compare values a writer may be overwriting at the same moment
+    static_assert(std::is_trivially_copyable_v<T>, "ConcurrentBTree needs trivially copyable values");
+
+    static constexpr size_t MaxKeys = 2 * t - 1;
+    static constexpr size_t MinKeys = t - 1; // the root is the only node allowed to hold fewer
+
+    struct Node
+    {
+        OptimisticLatch latch;
+        const bool is_leaf;
+        size_t count;
+        alignas(CacheLineSize) std::array<T, node_search::PaddedCapacity<T, MaxKeys>> keys;
+
+        explicit Node(bool is_leaf) : latch(), is_leaf(is_leaf), count(0), keys() {}
+    };
+    struct Leaf : Node
+    {
+        std::array<size_t, MaxKeys> counts;
+
+        Leaf() : Node(true), counts() {}
+    };
+    struct Inner : Node
+    {
+        std::array<Node*, MaxKeys + 1> children;
+
+        Inner() : Node(false), children() {}
+    };
+
+    std::atomic<Node*> root;
+    mutable epoch::EpochManager epochs;
+
+public:
+    // the tree must not be used by any other thread any more
+    ~ConcurrentBTree()
+    {
+        this->destroySubtree(this->root.load(std::memory_order_relaxed));
+    }
+    ConcurrentBTree(ConcurrentBTree&& other) = delete;
+    ConcurrentBTree& operator=(ConcurrentBTree&& other) = delete;
+    ConcurrentBTree(const ConcurrentBTree& other) = delete;
+    ConcurrentBTree& operator=(const ConcurrentBTree& other) = delete;
+    ConcurrentBTree() : root(new Leaf()), epochs() {}
+
+    void insert(const T& val);
+    // another thread may remove the value first, so a missing value is reported instead of thrown
+    bool remove(const T& val);
+    size_t count(const T& val)const;
+    bool contains(const T& val)const
+    {
+        return this->count(val) > 0;
+    }
+
+private:
+    // every attempt returns nothing or false when it has to restart from the root
+    std::optional<size_t> tryCount(const T& val)const;
+    bool tryInsert(const T& val);
+    std::optional<bool> tryRemove(const T& val);
+
+    void splitChild(Inner* parent, uint64_t parent_version, size_t index, Node* node, uint64_t version);
+    void rebalanceChild(Inner* parent, uint64_t parent_version, size_t index, Node* child, uint64_t child_version);
+    std::pair<T, Node*> splitNode(Node* node);
+    void borrowFromRight(Inner* parent, size_t separator, Node* left, Node* right);
+    void borrowFromLeft(Inner* parent, size_t separator, Node* left, Node* right);
+    void merge(Inner* parent, size_t separator, Node* left, Node* right);
+
+    // a racing writer may leave any count behind, clamping keeps optimistic reads inside the node
+    static size_t keyCount(const Node* node)
+    {
+        return std::min(node->count, MaxKeys);
+    }
+    static size_t searchKeys(const Node* node, size_t count, const T& val)
+    {
+        return node_search::lowerBound(node->keys.data(), count, val);
+    }
+    static void deleteNode(void* node)
+    {
+        auto typed = static_cast<Node*>(node);
+        if (typed->is_leaf)
+            delete static_cast<Leaf*>(typed);
+        else
+            delete static_cast<Inner*>(typed);
+    }
+    void retire(Node* node)
+    {
+        this->epochs.retire(node, &ConcurrentBTree::deleteNode);
+    }
+    void destroySubtree(Node* node)
+    {
+        if (!node->is_leaf)
+        {
+            auto inner = static_cast<Inner*>(node);
+            for (size_t i = 0; i <= inner->count; ++i)
+                this->destroySubtree(inner->children[i]);
+        }
+        deleteNode(node);
+    }
+};
+
+#include "concurrent_tree_impl.ipp"
+#endif
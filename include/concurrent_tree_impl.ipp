@@ -0,0 +1,408 @@
+#ifndef CONCURRENT_TREE_IMPL_TPP
+#define CONCURRENT_TREE_IMPL_TPP
+#include <cassert>
+#include "concurrent_tree.h"
+
+template <typename T, size_t t>
+size_t ConcurrentBTree<T, t>::count(const T& val)const
+{
+    auto guard = this->epochs.pin();
+    while (true)
+    {
+        if (std::optional<size_t> result = this->tryCount(val))
+            return *result;
+    }
+}
+
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::insert(const T& val)
+{
+    auto guard = this->epochs.pin();
+    while (!this->tryInsert(val))
+    {
+    }
+}
+
+template <typename T, size_t t>
+bool ConcurrentBTree<T, t>::remove(const T& val)
+{
+    auto guard = this->epochs.pin();
+    while (true)
+    {
+        if (std::optional<bool> removed = this->tryRemove(val))
+            return *removed;
+    }
+}
+
+template <typename T, size_t t>
+std::optional<size_t> ConcurrentBTree<T, t>::tryCount(const T& val)const
+{
+    Node* node = this->root.load(std::memory_order_acquire);
+    uint64_t version;
+    // a root that was replaced meanwhile holds only a part of the values
+    if (!node->latch.readLock(version) || node != this->root.load(std::memory_order_acquire))
+        return std::nullopt;
+
+    while (!node->is_leaf)
+    {
+        auto inner = static_cast<Inner*>(node);
+        Node* child = inner->children[searchKeys(inner, keyCount(inner), val)];
+        // the child pointer is only safe to follow if the node did not change while it was read
+        if (!inner->latch.validate(version))
+            return std::nullopt;
+        uint64_t child_version;
+        if (!child->latch.readLock(child_version) || !inner->latch.validate(version))
+            return std::nullopt;
+        node = child;
+        version = child_version;
+    }
+
+    auto leaf = static_cast<Leaf*>(node);
+    size_t count = keyCount(leaf);
+    size_t index = searchKeys(leaf, count, val);
+    size_t result = index < count && leaf->keys[index] == val ? leaf->counts[index] : 0;
+    if (!leaf->latch.validate(version))
+        return std::nullopt;
+    return result;
+}
+
+template <typename T, size_t t>
+bool ConcurrentBTree<T, t>::tryInsert(const T& val)
+{
+    Node* node = this->root.load(std::memory_order_acquire);
+    uint64_t version;
+    if (!node->latch.readLock(version) || node != this->root.load(std::memory_order_acquire))
+        return false;
+
+    Inner* parent = nullptr;
+    uint64_t parent_version = 0;
+    size_t index = 0; // slot of the node in the parent
+    while (!node->is_leaf)
+    {
+        auto inner = static_cast<Inner*>(node);
+        size_t count = keyCount(inner);
+        // full nodes are split on the way down, so the parent of a split always has room for the separator
+        if (count == MaxKeys)
+        {
+            this->splitChild(parent, parent_version, index, inner, version);
+            return false;
+        }
+        size_t child_index = searchKeys(inner, count, val);
+        Node* child = inner->children[child_index];
+        if (!inner->latch.validate(version))
+            return false;
+        uint64_t child_version;
+        if (!child->latch.readLock(child_version) || !inner->latch.validate(version))
+            return false;
+        parent = inner;
+        parent_version = version;
+        index = child_index;
+        node = child;
+        version = child_version;
+    }
+
+    auto leaf = static_cast<Leaf*>(node);
+    size_t count = keyCount(leaf);
+    size_t position = searchKeys(leaf, count, val);
+    bool present = position < count && leaf->keys[position] == val;
+    if (!present && count == MaxKeys)
+    {
+        this->splitChild(parent, parent_version, index, leaf, version);
+        return false;
+    }
+    // the values a leaf may hold only change under its own latch, so the unchanged version is all that is needed
+    if (!leaf->latch.tryUpgrade(version))
+        return false;
+
+    if (present)
+    {
+        leaf->counts[position]++;
+    }
+    else
+    {
+        std::copy_backward(leaf->keys.begin() + position, leaf->keys.begin() + count, leaf->keys.begin() + count + 1);
+        std::copy_backward(leaf->counts.begin() + position, leaf->counts.begin() + count, leaf->counts.begin() + count + 1);
+        leaf->keys[position] = val;
+        leaf->counts[position] = 1;
+        leaf->count++;
+    }
+    leaf->latch.writeUnlock();
+    return true;
+}
+
+template <typename T, size_t t>
+std::optional<bool> ConcurrentBTree<T, t>::tryRemove(const T& val)
+{
+    Node* node = this->root.load(std::memory_order_acquire);
+    uint64_t version;
+    if (!node->latch.readLock(version) || node != this->root.load(std::memory_order_acquire))
+        return std::nullopt;
+
+    while (!node->is_leaf)
+    {
+        auto inner = static_cast<Inner*>(node);
+        size_t child_index = searchKeys(inner, keyCount(inner), val);
+        Node* child = inner->children[child_index];
+        if (!inner->latch.validate(version))
+            return std::nullopt;
+        uint64_t child_version;
+        if (!child->latch.readLock(child_version) || !inner->latch.validate(version))
+            return std::nullopt;
+        // minimal nodes are refilled on the way down, so a merge below always leaves its parent valid
+        if (keyCount(child) <= MinKeys)
+        {
+            this->rebalanceChild(inner, version, child_index, child, child_version);
+            return std::nullopt;
+        }
+        node = child;
+        version = child_version;
+    }
+
+    auto leaf = static_cast<Leaf*>(node);
+    size_t count = keyCount(leaf);
+    size_t position = searchKeys(leaf, count, val);
+    if (position == count || leaf->keys[position] != val)
+    {
+        if (!leaf->latch.validate(version))
+            return std::nullopt;
+        return false;
+    }
+    if (!leaf->latch.tryUpgrade(version))
+        return std::nullopt;
+
+    if (leaf->counts[position] > 1)
+    {
+        leaf->counts[position]--;
+    }
+    else
+    {
+        std::copy(leaf->keys.begin() + position + 1, leaf->keys.begin() + count, leaf->keys.begin() + position);
+        std::copy(leaf->counts.begin() + position + 1, leaf->counts.begin() + count, leaf->counts.begin() + position);
+        leaf->count--;
+    }
+    leaf->latch.writeUnlock();
+    return true;
+}
+
+// lock the node and its parent, split the node and restart; the caller checked the node under the given version
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::splitChild(Inner* parent, uint64_t parent_version, size_t index, Node* node, uint64_t version)
+{
+    if (parent && !parent->latch.tryUpgrade(parent_version))
+        return;
+    if (!node->latch.tryUpgrade(version))
+    {
+        if (parent)
+            parent->latch.writeUnlock();
+        return;
+    }
+    if (!parent && node != this->root.load(std::memory_order_acquire))
+    {
+        node->latch.writeUnlock(); // another thread grew the tree above this node
+        return;
+    }
+
+    auto [separator, right] = this->splitNode(node);
+    if (parent)
+    {
+        size_t count = parent->count;
+        std::copy_backward(parent->keys.begin() + index, parent->keys.begin() + count, parent->keys.begin() + count + 1);
+        std::copy_backward(parent->children.begin() + index + 1, parent->children.begin() + count + 1,
+                           parent->children.begin() + count + 2);
+        parent->keys[index] = separator;
+        parent->children[index + 1] = right;
+        parent->count++;
+    }
+    else
+    {
+        auto new_root = new Inner();
+        new_root->keys[0] = separator;
+        new_root->children[0] = node;
+        new_root->children[1] = right;
+        new_root->count = 1;
+        this->root.store(new_root, std::memory_order_release);
+    }
+
+    node->latch.writeUnlock();
+    if (parent)
+        parent->latch.writeUnlock();
+}
+
+// move the upper half of a locked full node into a new right sibling and return the separator between the two
+template <typename T, size_t t>
+std::pair<T, typename ConcurrentBTree<T, t>::Node*> ConcurrentBTree<T, t>::splitNode(Node* node)
+{
+    size_t count = node->count;
+    size_t mid = count / 2;
+    if (node->is_leaf)
+    {
+        // in a leaf the separator is a copy of the largest value staying on the left
+        auto leaf = static_cast<Leaf*>(node);
+        auto right = new Leaf();
+        std::copy(leaf->keys.begin() + mid, leaf->keys.begin() + count, right->keys.begin());
+        std::copy(leaf->counts.begin() + mid, leaf->counts.begin() + count, right->counts.begin());
+        right->count = count - mid;
+        leaf->count = mid;
+        return { leaf->keys[mid - 1], right };
+    }
+
+    // in an inner node the middle separator moves up
+    auto inner = static_cast<Inner*>(node);
+    auto right = new Inner();
+    std::copy(inner->keys.begin() + mid + 1, inner->keys.begin() + count, right->keys.begin());
+    std::copy(inner->children.begin() + mid + 1, inner->children.begin() + count + 1, right->children.begin());
+    right->count = count - mid - 1;
+    inner->count = mid;
+    return { inner->keys[mid], right };
+}
+
+// lock the minimal child, its parent and a sibling, borrow a value from the sibling or merge with it and restart
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::rebalanceChild(Inner* parent, uint64_t parent_version, size_t index, Node* child, uint64_t child_version)
+{
+    if (!parent->latch.tryUpgrade(parent_version))
+        return;
+    if (!child->latch.tryUpgrade(child_version))
+    {
+        parent->latch.writeUnlock();
+        return;
+    }
+    // the right sibling is preferred, the last child has only a left one
+    size_t sibling_index = index < parent->count ? index + 1 : index - 1;
+    Node* sibling = parent->children[sibling_index];
+    if (!sibling->latch.tryWriteLock())
+    {
+        child->latch.writeUnlock();
+        parent->latch.writeUnlock();
+        return;
+    }
+
+    size_t separator = std::min(index, sibling_index);
+    Node* left = parent->children[separator];
+    Node* right = parent->children[separator + 1];
+    if (sibling->count > MinKeys)
+    {
+        if (sibling == right)
+            this->borrowFromRight(parent, separator, left, right);
+        else
+            this->borrowFromLeft(parent, separator, left, right);
+        left->latch.writeUnlock();
+        right->latch.writeUnlock();
+        parent->latch.writeUnlock();
+        return;
+    }
+
+    this->merge(parent, separator, left, right);
+    left->latch.writeUnlock();
+    right->latch.writeUnlockObsolete();
+    this->retire(right);
+    if (parent->count == 0)
+    {
+        // any other node still had a spare separator when the descent checked it, so this is the root
+        assert(parent == this->root.load(std::memory_order_relaxed));
+        this->root.store(left, std::memory_order_release);
+        parent->latch.writeUnlockObsolete();
+        this->retire(parent);
+        return;
+    }
+    parent->latch.writeUnlock();
+}
+
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::borrowFromRight(Inner* parent, size_t separator, Node* left, Node* right)
+{
+    size_t left_count = left->count;
+    size_t right_count = right->count;
+    if (left->is_leaf)
+    {
+        auto left_leaf = static_cast<Leaf*>(left);
+        auto right_leaf = static_cast<Leaf*>(right);
+        left_leaf->keys[left_count] = right_leaf->keys[0];
+        left_leaf->counts[left_count] = right_leaf->counts[0];
+        std::copy(right_leaf->keys.begin() + 1, right_leaf->keys.begin() + right_count, right_leaf->keys.begin());
+        std::copy(right_leaf->counts.begin() + 1, right_leaf->counts.begin() + right_count, right_leaf->counts.begin());
+        parent->keys[separator] = left_leaf->keys[left_count];
+    }
+    else
+    {
+        auto left_inner = static_cast<Inner*>(left);
+        auto right_inner = static_cast<Inner*>(right);
+        left_inner->keys[left_count] = parent->keys[separator];
+        left_inner->children[left_count + 1] = right_inner->children[0];
+        parent->keys[separator] = right_inner->keys[0];
+        std::copy(right_inner->keys.begin() + 1, right_inner->keys.begin() + right_count, right_inner->keys.begin());
+        std::copy(right_inner->children.begin() + 1, right_inner->children.begin() + right_count + 1,
+                  right_inner->children.begin());
+    }
+    left->count = left_count + 1;
+    right->count = right_count - 1;
+}
+
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::borrowFromLeft(Inner* parent, size_t separator, Node* left, Node* right)
+{
+    size_t left_count = left->count;
+    size_t right_count = right->count;
+    if (left->is_leaf)
+    {
+        auto left_leaf = static_cast<Leaf*>(left);
+        auto right_leaf = static_cast<Leaf*>(right);
+        std::copy_backward(right_leaf->keys.begin(), right_leaf->keys.begin() + right_count,
+                           right_leaf->keys.begin() + right_count + 1);
+        std::copy_backward(right_leaf->counts.begin(), right_leaf->counts.begin() + right_count,
+                           right_leaf->counts.begin() + right_count + 1);
+        right_leaf->keys[0] = left_leaf->keys[left_count - 1];
+        right_leaf->counts[0] = left_leaf->counts[left_count - 1];
+        parent->keys[separator] = left_leaf->keys[left_count - 2];
+    }
+    else
+    {
+        auto left_inner = static_cast<Inner*>(left);
+        auto right_inner = static_cast<Inner*>(right);
+        std::copy_backward(right_inner->keys.begin(), right_inner->keys.begin() + right_count,
+                           right_inner->keys.begin() + right_count + 1);
+        std::copy_backward(right_inner->children.begin(), right_inner->children.begin() + right_count + 1,
+                           right_inner->children.begin() + right_count + 2);
+        right_inner->keys[0] = parent->keys[separator];
+        right_inner->children[0] = left_inner->children[left_count];
+        parent->keys[separator] = left_inner->keys[left_count - 1];
+    }
+    left->count = left_count - 1;
+    right->count = right_count + 1;
+}
+
+// move the right node and, between inner nodes, the separator into the left node and drop both from the parent
+template <typename T, size_t t>
+void ConcurrentBTree<T, t>::merge(Inner* parent, size_t separator, Node* left, Node* right)
+{
+    size_t left_count = left->count;
+    size_t right_count = right->count;
+    if (left->is_leaf)
+    {
+        auto left_leaf = static_cast<Leaf*>(left);
+        auto right_leaf = static_cast<Leaf*>(right);
+        std::copy(right_leaf->keys.begin(), right_leaf->keys.begin() + right_count, left_leaf->keys.begin() + left_count);
+        std::copy(right_leaf->counts.begin(), right_leaf->counts.begin() + right_count,
+                  left_leaf->counts.begin() + left_count);
+        left->count = left_count + right_count;
+    }
+    else
+    {
+        auto left_inner = static_cast<Inner*>(left);
+        auto right_inner = static_cast<Inner*>(right);
+        left_inner->keys[left_count] = parent->keys[separator];
+        std::copy(right_inner->keys.begin(), right_inner->keys.begin() + right_count,
+                  left_inner->keys.begin() + left_count + 1);
+        std::copy(right_inner->children.begin(), right_inner->children.begin() + right_count + 1,
+                  left_inner->children.begin() + left_count + 1);
+        left->count = left_count + right_count + 1;
+    }
+
+    size_t parent_count = parent->count;
+    std::copy(parent->keys.begin() + separator + 1, parent->keys.begin() + parent_count, parent->keys.begin() + separator);
+    std::copy(parent->children.begin() + separator + 2, parent->children.begin() + parent_count + 1,
+              parent->children.begin() + separator + 1);
+    parent->count = parent_count - 1;
+}
+
+#endif
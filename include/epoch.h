@@ -0,0 +1,165 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+/*
+Epoch-based memory reclamation.
+A thread pins the current global epoch for the duration of an operation. Memory unlinked from a shared
+structure is retired with the epoch it was retired in and freed only after the global epoch has moved two
+steps further: the epoch only advances once every pinned thread has seen the current one, so by then no
+thread can still hold a reference obtained before the memory was unlinked.
+Threads get one of MaxThreads slots on first use and give it back when they exit.
+*/
+namespace epoch
+{
+    inline constexpr size_t MaxThreads = 256;
+
+    namespace detail
+    {
+        inline std::array<std::atomic<bool>, MaxThreads> taken_slots{};
+
+        struct ThreadSlot
+        {
+            size_t index;
+            ThreadSlot() : index(MaxThreads)
+            {
+                for (size_t i = 0; i < MaxThreads; i++)
+                {
+                    bool expected = false;
+                    if (taken_slots[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    {
+                        index = i;
+                        return;
+                    }
+                }
+                throw std::runtime_error("epoch: more than MaxThreads threads use the reclamation at the same time");
+            }
+            ~ThreadSlot()
+            {
+                taken_slots[index].store(false, std::memory_order_release);
+            }
+        };
+
+        inline size_t threadSlot()
+        {
+            thread_local ThreadSlot slot;
+            return slot.index;
+        }
+    }
+
+    class EpochManager
+    {
+    private:
+        static constexpr uint64_t Inactive = 0;
+        static constexpr size_t CollectThreshold = 64; // retired objects a thread gathers before trying to free them
+
+        struct Retired
+        {
+            void* object;
+            void (*deleter)(void*);
+            uint64_t epoch;
+        };
+        // every slot sits on its own cache line, only its owning thread touches the retired list
+        struct alignas(64) Slot
+        {
+            std::atomic<uint64_t> epoch{Inactive};
+            std::vector<Retired> retired;
+        };
+
+        std::atomic<uint64_t> global_epoch;
+        std::array<Slot, MaxThreads> slots;
+
+    public:
+        class Guard
+        {
+            EpochManager* manager;
+            size_t slot;
+        public:
+            Guard(EpochManager* manager, size_t slot) : manager(manager), slot(slot) {}
+            Guard(Guard&& other) = delete;
+            Guard& operator=(Guard&& other) = delete;
+            Guard(const Guard& other) = delete;
+            Guard& operator=(const Guard& other) = delete;
+            ~Guard()
+            {
+                manager->slots[slot].epoch.store(Inactive, std::memory_order_release);
+            }
+        };
+
+        EpochManager() : global_epoch(1), slots() {}
+        EpochManager(EpochManager&& other) = delete;
+        EpochManager& operator=(EpochManager&& other) = delete;
+        EpochManager(const EpochManager& other) = delete;
+        EpochManager& operator=(const EpochManager& other) = delete;
+        // no thread may be pinned any more, everything still retired is freed
+        ~EpochManager()
+        {
+            for (Slot& slot : this->slots)
+                for (Retired& retired : slot.retired)
+                    retired.deleter(retired.object);
+        }
+
+        // pin the calling thread to the current epoch until the guard goes out of scope, guards do not nest
+        [[nodiscard]] Guard pin()
+        {
+            size_t index = detail::threadSlot();
+            std::atomic<uint64_t>& slot_epoch = this->slots[index].epoch;
+            uint64_t current = this->global_epoch.load(std::memory_order_seq_cst);
+            while (true)
+            {
+                slot_epoch.store(current, std::memory_order_seq_cst);
+                // the epoch may have moved on before the pin became visible, pin again until it is stable
+                uint64_t now = this->global_epoch.load(std::memory_order_seq_cst);
+                if (now == current)
+                    break;
+                current = now;
+            }
+            return Guard(this, index);
+        }
+
+        // hand over an object that is no longer reachable, the calling thread must be pinned
+        void retire(void* object, void (*deleter)(void*))
+        {
+            Slot& slot = this->slots[detail::threadSlot()];
+            slot.retired.push_back({ object, deleter, this->global_epoch.load(std::memory_order_seq_cst) });
+            if (slot.retired.size() >= CollectThreshold)
+            {
+                this->tryAdvance();
+                this->collect(slot);
+            }
+        }
+
+    private:
+        void tryAdvance()
+        {
+            uint64_t current = this->global_epoch.load(std::memory_order_seq_cst);
+            for (const Slot& slot : this->slots)
+            {
+                uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+                if (pinned != Inactive && pinned != current)
+                    return;
+            }
+            this->global_epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+        }
+        void collect(Slot& slot)
+        {
+            uint64_t current = this->global_epoch.load(std::memory_order_seq_cst);
+            size_t kept = 0;
+            for (Retired& retired : slot.retired)
+            {
+                if (retired.epoch + 2 <= current)
+                    retired.deleter(retired.object);
+                else
+                    slot.retired[kept++] = retired;
+            }
+            slot.retired.resize(kept);
+        }
+    };
+}
+#endif
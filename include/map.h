@@ -0,0 +1,251 @@
+#ifndef MAP_H
+#define MAP_H
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "node_pool.h"
+#include "node_search.h"
+#include "top_down_node.h"
+
+
+/*
+Ordered map from K to V on a B-tree, ordered by Compare instead of operator<.
+Keys are unique. try_emplace and emplace leave an existing entry alone and insert_or_assign overwrites its value,
+the returned flag is the only report of a key that was already there.
+Entries are moved, never copied, when nodes split, lend entries or merge, so V may be move-only. A key or a value
+is built only once its key is known to be missing. Both types have to be default constructible, the node arrays
+hold every slot.
+With a transparent Compare, std::less<> for instance, find, contains, at and erase take anything the comparator
+can order against K, so a map keyed by std::string is searched with a std::string_view without building a string.
+Insertions and removals run top-down in a single pass as in BTree with Restructuring::TopDown, on TopDownNode
+with the value as the payload of an entry.
+*/
+template <typename K, typename V, typename Compare = std::less<K>, size_t t = 16>
+class BTreeMap
+{
+    static constexpr size_t MinDegree = 2;
+    static_assert(t >= MinDegree, "t value must be at least 2");
+    static_assert(std::is_default_constructible_v<K> && std::is_default_constructible_v<V>,
+                  "BTreeMap keeps its keys and values in arrays of default constructed slots");
+    static_assert(std::is_move_assignable_v<K> && std::is_move_assignable_v<V>,
+                  "BTreeMap moves its keys and values between the slots");
+
+    using Node = TopDownNode<K, V, t, Sharing::Exclusive>;
+    static constexpr size_t MaxKeys = Node::MaxKeys;
+    // the vector search knows only the natural order of arithmetic keys
+    static constexpr bool VectorSearch = std::is_arithmetic_v<K> &&
+                                         (std::is_same_v<Compare, std::less<K>> || std::is_same_v<Compare, std::less<>>);
+
+    NodePool<Node> pool;
+    Node* root;
+    size_t entries;
+    [[no_unique_address]] Compare compare;
+
+public:
+    // other key types are accepted by the lookups only when the comparator declares it can order them against K
+    template <typename Key>
+    static constexpr bool IsLookupKey = std::is_same_v<Key, K> || requires { typename Compare::is_transparent; };
+
+    ~BTreeMap()
+    {
+        this->destroySubtree(this->root);
+    }
+    BTreeMap(BTreeMap&& other) = delete;
+    BTreeMap& operator=(BTreeMap&& other) = delete;
+    BTreeMap(const BTreeMap& other) = delete;
+    BTreeMap& operator=(const BTreeMap& other) = delete;
+    explicit BTreeMap(const Compare& compare = Compare()) : pool(), root(nullptr), entries(0), compare(compare)
+    {
+        this->root = this->pool.create(true);
+    }
+
+    size_t size()const
+    {
+        return this->entries;
+    }
+    bool empty()const
+    {
+        return this->entries == 0;
+    }
+
+    // the pointer refers to the value of the key, the flag tells whether the entry was created by the call
+    template <typename... Args>
+    std::pair<V*, bool> try_emplace(const K& key, Args&&... args)
+    {
+        return this->insertUnique(key, std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    std::pair<V*, bool> try_emplace(K&& key, Args&&... args)
+    {
+        return this->insertUnique(std::move(key), std::forward<Args>(args)...);
+    }
+    // the entry is built from the arguments as a key and value pair first, the pair is dropped if the key exists
+    template <typename... Args>
+    std::pair<V*, bool> emplace(Args&&... args)
+    {
+        std::pair<K, V> entry(std::forward<Args>(args)...);
+        return this->insertUnique(std::move(entry.first), std::move(entry.second));
+    }
+    template <typename M>
+    std::pair<V*, bool> insert_or_assign(const K& key, M&& value)
+    {
+        return this->insertOrAssign(key, std::forward<M>(value));
+    }
+    template <typename M>
+    std::pair<V*, bool> insert_or_assign(K&& key, M&& value)
+    {
+        return this->insertOrAssign(std::move(key), std::forward<M>(value));
+    }
+    V& operator[](const K& key)
+    {
+        return *this->insertUnique(key).first;
+    }
+    V& operator[](K&& key)
+    {
+        return *this->insertUnique(std::move(key)).first;
+    }
+
+    // nullptr when the key is missing
+    V* find(const K& key)
+    {
+        return this->findValue(key);
+    }
+    const V* find(const K& key)const
+    {
+        return this->findValue(key);
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    V* find(const Key& key)
+    {
+        return this->findValue(key);
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    const V* find(const Key& key)const
+    {
+        return this->findValue(key);
+    }
+    bool contains(const K& key)const
+    {
+        return this->findValue(key) != nullptr;
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    bool contains(const Key& key)const
+    {
+        return this->findValue(key) != nullptr;
+    }
+    V& at(const K& key)
+    {
+        return *this->requireValue(key);
+    }
+    const V& at(const K& key)const
+    {
+        return *this->requireValue(key);
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    V& at(const Key& key)
+    {
+        return *this->requireValue(key);
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    const V& at(const Key& key)const
+    {
+        return *this->requireValue(key);
+    }
+
+    // the number of entries removed, 0 or 1
+    size_t erase(const K& key)
+    {
+        return this->eraseKey(key);
+    }
+    template <typename Key> requires IsLookupKey<Key>
+    size_t erase(const Key& key)
+    {
+        return this->eraseKey(key);
+    }
+
+    // call visit(key, value) for every entry in ascending key order
+    template <typename Visit>
+    void forEach(Visit&& visit)const
+    {
+        auto read_only = [&visit](const K& key, const V& value) { visit(key, value); };
+        this->visitSubtree(this->root, read_only);
+    }
+    template <typename Visit>
+    void forEach(Visit&& visit)
+    {
+        this->visitSubtree(this->root, visit);
+    }
+
+private:
+    template <typename Key>
+    size_t lowerBound(const Node* node, const Key& key)const
+    {
+        if constexpr (VectorSearch && std::is_same_v<Key, K>)
+            return node_search::lowerBound(node->keys.data(), node->count, key);
+        else
+            return static_cast<size_t>(std::lower_bound(node->keys.begin(), node->keys.begin() + node->count, key,
+                                                        this->compare) - node->keys.begin());
+    }
+    // the key at a lower bound is not less than key, it is the same key unless key is less than it
+    template <typename Key>
+    bool matches(const Node* node, size_t index, const Key& key)const
+    {
+        return index < node->count && !this->compare(key, node->keys[index]);
+    }
+    template <typename Key>
+    V* findValue(const Key& key)const;
+    template <typename Key>
+    V* requireValue(const Key& key)const
+    {
+        if (V* value = this->findValue(key))
+            return value;
+        throw std::out_of_range("The key is not in the map");
+    }
+    template <typename KeyArg, typename... Args>
+    std::pair<V*, bool> insertUnique(KeyArg&& key, Args&&... args);
+    template <typename KeyArg, typename M>
+    std::pair<V*, bool> insertOrAssign(KeyArg&& key, M&& value)
+    {
+        auto [slot, inserted] = this->insertUnique(std::forward<KeyArg>(key), std::forward<M>(value));
+        if (!inserted)
+            *slot = std::forward<M>(value); // only one of the two calls consumes the value
+        return { slot, inserted };
+    }
+    template <typename Key>
+    size_t eraseKey(const Key& key);
+
+    void splitChild(Node* parent, size_t index)
+    {
+        parent->splitChild(index, this->pool.create(parent->children[index]->is_leaf));
+    }
+    void refillChild(Node* parent, size_t index)
+    {
+        this->pool.destroy(parent->refillChild(index)); // nullptr unless the child was merged with a sibling
+    }
+    template <typename Visit>
+    static void visitSubtree(Node* node, Visit& visit)
+    {
+        for (size_t i = 0; i < node->count; i++)
+        {
+            if (!node->is_leaf)
+                visitSubtree(node->children[i], visit);
+            visit(std::as_const(node->keys[i]), node->payloads[i]);
+        }
+        if (!node->is_leaf)
+            visitSubtree(node->children[node->count], visit);
+    }
+    void destroySubtree(Node* node)
+    {
+        if (!node->is_leaf)
+            for (size_t i = 0; i <= node->count; ++i)
+                this->destroySubtree(node->children[i]);
+        this->pool.destroy(node);
+    }
+};
+
+#include "map_impl.ipp"
+#endif
@@ -0,0 +1,119 @@
+#ifndef MAP_IMPL_TPP
+#define MAP_IMPL_TPP
+#include "map.h"
+
+template <typename K, typename V, typename Compare, size_t t>
+template <typename Key>
+V* BTreeMap<K, V, Compare, t>::findValue(const Key& key)const
+{
+    Node* node = this->root;
+    while (true)
+    {
+        size_t index = this->lowerBound(node, key);
+        if (this->matches(node, index, key))
+            return &node->payloads[index];
+        if (node->is_leaf)
+            return nullptr;
+        node = node->children[index];
+    }
+}
+
+template <typename K, typename V, typename Compare, size_t t>
+template <typename KeyArg, typename... Args>
+std::pair<V*, bool> BTreeMap<K, V, Compare, t>::insertUnique(KeyArg&& key, Args&&... args)
+{
+    // a root without a free slot is pushed down under a new one and halved, so the loop starts in a node with room
+    if (this->root->count == MaxKeys)
+    {
+        Node* new_root = this->pool.create(false);
+        new_root->children[0] = this->root;
+        this->root = new_root;
+        this->splitChild(new_root, 0);
+    }
+
+    Node* node = this->root;
+    while (true)
+    {
+        size_t index = this->lowerBound(node, key);
+        if (this->matches(node, index, key))
+            return { &node->payloads[index], false };
+        if (node->is_leaf)
+        {
+            // the entry is built before the slot is opened, a throwing constructor leaves the node as it was
+            K new_key(std::forward<KeyArg>(key));
+            V new_value(std::forward<Args>(args)...);
+            node->insertEntry(index, std::move(new_key), std::move(new_value));
+            this->entries++;
+            return { &node->payloads[index], true };
+        }
+        if (node->children[index]->count == MaxKeys)
+        {
+            this->splitChild(node, index); // the child's median now sits at index, the key is compared with it next
+            continue;
+        }
+        node = node->children[index];
+    }
+}
+
+template <typename K, typename V, typename Compare, size_t t>
+template <typename Key>
+size_t BTreeMap<K, V, Compare, t>::eraseKey(const Key& key)
+{
+    /*
+    One pass from the root: a child holding only t - 1 entries gets one from a sibling, or is merged with one,
+    before the descent moves into it, so the leaf that gives up an entry in the end stays within bounds.
+    When the key sits in an inner node the node keeps the slot while the descent follows the right edge of the
+    left subtree, the largest entry there then moves up and overwrites the erased one.
+    */
+    Node* node = this->root;
+    Node* holder = nullptr; // the inner node holding the key, once the predecessor is sought
+    size_t holder_index = 0;
+    while (true)
+    {
+        size_t index = node->count;
+        bool found = false;
+        if (!holder)
+        {
+            index = this->lowerBound(node, key);
+            found = this->matches(node, index, key);
+            if (node->is_leaf)
+            {
+                if (!found)
+                    return 0;
+                node->eraseEntry(index);
+                this->entries--;
+                return 1;
+            }
+        }
+        else if (node->is_leaf)
+        {
+            holder->keys[holder_index] = std::move(node->keys[node->count - 1]);
+            holder->payloads[holder_index] = std::move(node->payloads[node->count - 1]);
+            node->eraseEntry(node->count - 1);
+            this->entries--;
+            return 1;
+        }
+
+        if (node->children[index]->count < t)
+        {
+            this->refillChild(node, index);
+            if (this->root->count == 0)
+            {
+                // the merge took the last entry of the root, the merged node below replaces it one level higher
+                Node* old_root = this->root;
+                this->root = old_root->children[0];
+                this->pool.destroy(old_root);
+                node = this->root;
+            }
+            continue; // entries moved between the child and its siblings, so the lookup in this node is repeated
+        }
+        if (found)
+        {
+            holder = node;
+            holder_index = index;
+        }
+        node = node->children[index];
+    }
+}
+
+#endif
@@ -1,222 +1,354 @@
 #ifndef NODE_H
 #define NODE_H
 #include <algorithm>
+#include <format>
+#include <array>
 #include <iostream>
-#include <memory>
 #include <stdexcept>
-#include <vector>
 #include <cassert>
+#include <type_traits>
 #include <utility>
+#include "node_pool.h"
+#include "node_search.h"
+#include "tree_stats.h"
 
 
-template <typename T>
-class BTreeNode : public std::enable_shared_from_this<BTreeNode<T>>
-{
-private:
-    struct Entry
-    {
-        T data;
-        size_t count;
-        Entry() : data(), count(0) {};
-        Entry(T data) : data(data), count(1) {};
-        void addData()
-        {
-            count++;
-        }
-        bool operator<(const Entry& other) const
-        {
-            return data < other.data;
-        }
+template <typename T, size_t t, bool OrderStatistics = false>
+class BTreeIterator;
 
-        bool operator==(const Entry& other) const
-        {
-            return data == other.data;
-        }
-
-        bool operator>(const Entry& other) const
-        {
-            return data > other.data;
-        }
+// when a BTree restores the bounds on the number of values in its nodes
+enum class Restructuring
+{
+    BottomUp, // after the change, from the changed node up through the parents
+    TopDown   // before the change, on the way down: full nodes are split and minimal ones refilled
+};
 
-        bool operator>=(const Entry& other) const
-        {
-            return data >= other.data;
-        }
-        bool operator<=(const Entry& other) const
-        {
-            return data <= other.data;
-        }
-    };
-    
-    size_t t;
-    std::vector<Entry> values;
-    std::vector<std::shared_ptr<BTreeNode<T>>> children;
-    std::weak_ptr<BTreeNode<T>> parent;
+/*
+With OrderStatistics every node also knows how many values its subtree holds, duplicates included.
+Single insertions and removals update the ancestors on the way up, restructuring recounts the nodes it touches.
+*/
+template <typename T, size_t t, bool OrderStatistics = false>
+class BTreeNode
+{
+    friend class BTreeIterator<T, t, OrderStatistics>; // iterators walk the arrays directly, without the bounds checks
+public:
+    using Pool = std::conditional_t<StatsEnabled, CountingNodePool<BTreeNode<T, t, OrderStatistics>>,
+                                    NodePool<BTreeNode<T, t, OrderStatistics>>>;
+    // bottom-up a node keeps at most 2t - 2 values, the last slot only holds the value that triggers a split,
+    // top-down it can be full with 2t - 1 values and is split before an insertion passes through it
+    static constexpr size_t MaxVals = 2 * t - 1;
+    static constexpr size_t MaxChildren = MaxVals + 1;
+private:
+    /*
+    The keys live in their own cache line aligned array, apart from the duplicate counts and the children,
+    so the search inside a node streams through keys only. The array is padded for the vector search.
+    */
+    alignas(CacheLineSize) std::array<T, node_search::PaddedCapacity<T, MaxVals>> keys;
+    std::array<size_t, MaxVals> counts;
+    std::array<BTreeNode<T, t, OrderStatistics>*, MaxChildren> children;
+    Pool* pool; // the pool owning this node and its future siblings
+    BTreeNode<T, t, OrderStatistics>* parent;
+    size_t position; // index of this node among the children of its parent
+    size_t vals_count;
+    size_t children_count;
+    struct NoSubtreeSize {};
+    [[no_unique_address]] std::conditional_t<OrderStatistics, size_t, NoSubtreeSize> subtree_size;
     bool is_root;
     bool is_leaf;
 
 public:
     ~BTreeNode() = default;
     BTreeNode(
-        size_t t, std::vector<Entry>&& values,
-        std::vector<std::shared_ptr<BTreeNode<T>>>&& children,
-        const std::weak_ptr<BTreeNode<T>>& parent, bool is_root,
-        bool is_leaf) : t(t),
-        values(values),
-        children(children),
+        Pool* pool, BTreeNode<T, t, OrderStatistics>* parent, bool is_root,
+        bool is_leaf) : keys(),
+        pool(pool),
         parent(parent),
+        position(0),
+        vals_count(0),
+        children_count(0),
+        subtree_size(),
         is_root(is_root),
-        is_leaf(is_leaf) {
+        is_leaf(is_leaf)
+    {
     }
     BTreeNode(BTreeNode&& other) = delete;
     BTreeNode& operator=(BTreeNode&& other) = delete;
     BTreeNode(const BTreeNode& other) = delete;
     BTreeNode& operator=(const BTreeNode& other) = delete;
-    BTreeNode(
-        size_t t) :
-        t(t),
-        values(),
-        children(t + 1, nullptr),
-        parent(),
-        is_root(true),
-        is_leaf(true) 
+    explicit BTreeNode(
+        Pool* pool) :
+        BTreeNode(pool, nullptr, true, true)
     {
-        values.reserve(t);
     }
-    bool isLeaf()const 
+    bool isLeaf()const
     {
         return is_leaf;
     }
-    void insertVal(const T& val) 
+    void insertVal(const T& val)
+    {
+        this->addVal(val);
+        if (this->vals_count >= 2 * t - 1)
+            this->split();
+    }
+    // insert val, or count one more duplicate of it, without splitting the node
+    void addVal(const T& val)
     {
         size_t index = findLowerBoundIndexOfVal(val);
         bool lower_bound_in_node = index != this->getValsCount();
 
-        if (lower_bound_in_node && this->getValAtIndex(index) == val) 
+        if (lower_bound_in_node && this->keys[index] == val)
         {
-            std::cerr << std::format("WARNING: Value with key = {} is already in the tree", val) << '\n';
-            this->increaseEntryCount(index);
-            
+            this->increaseEntryCount(index); // a repeated value is expected, it is counted silently
         }
-        else 
+        else
         {
-            values.insert(values.begin() + index, Entry(val));
+            this->insertEntry(index, val, 1);
         }
-
-        if (values.size() >= 2 * t - 1)
-            this->split();
+        this->addToSubtreeSizes(1);
     }
     void fixUnderflow();
-    void swapWithPredecessor(std::shared_ptr<BTreeNode<T>>leaf, size_t index) 
+    /*
+    Top-down restructuring, called on the parent on the way down so nothing has to climb back up.
+    splitChild splits a full child around its median, which moves up into this node.
+    refillChild brings a child with t - 1 values up to at least t by a rotation from a sibling or a merge with one,
+    a root left without values by the merge takes over the contents of the merged child.
+    */
+    void splitChild(size_t index);
+    void refillChild(size_t index);
+    void swapWithPredecessor(BTreeNode<T, t, OrderStatistics>* leaf, size_t index)
     {
         if (!leaf->is_leaf)
             throw std::runtime_error("swapWithLeaf called on non-leaf node");
         if (!checkValuesBounds(index))
             throw std::out_of_range("Value in leaf index is out of range");
 
-        std::swap(this->values[index], leaf->values.back());
+        std::swap(this->keys[index], leaf->keys[leaf->vals_count - 1]);
+        std::swap(this->counts[index], leaf->counts[leaf->vals_count - 1]);
+        if constexpr (OrderStatistics)
+        {
+            // the duplicates of the two entries changed places, only the nodes in between see a different total
+            size_t moved_up = this->counts[index];
+            size_t moved_down = leaf->counts[leaf->vals_count - 1];
+            for (BTreeNode<T, t, OrderStatistics>* node = leaf; node != this; node = node->parent)
+                node->subtree_size = node->subtree_size + moved_down - moved_up;
+        }
     }
     void split();
-    void removeValueByIndex(size_t index) 
+    void removeValueByIndex(size_t index)
     {
         if (!checkValuesBounds(index))
             throw std::out_of_range("Attempt to delete invalid index from values");
 
-        Entry& entry = this->values[index];
-        if (entry.count == 1)
-            this->values.erase(this->values.begin() + index);
+        if (this->counts[index] == 1)
+            this->eraseEntry(index);
         else
-            entry.count--;
+            this->counts[index]--;
+        this->addToSubtreeSizes(-1);
 
         if (this->getValsCount() < t - 1)
             this->fixUnderflow();
     }
-    size_t findLowerBoundIndexOfVal(const T& val)const 
+    size_t findLowerBoundIndexOfVal(const T& val)const
     {
-        auto it = std::lower_bound(this->values.begin(), this->values.end(), val);
-        if (it == this->values.end())
-            return this->getValsCount();
-        return std::distance(this->values.begin(), it);
+        return node_search::lowerBound(this->keys.data(), this->vals_count, val);
     }
-    size_t findIndexOfVal(const T& val)const 
+    size_t findIndexOfVal(const T& val)const
     {
         auto index = this->findLowerBoundIndexOfVal(val);
-        if (index == this->getValsCount() || this->values[index].data != val)
+        if (index == this->getValsCount() || this->keys[index] != val)
             throw std::runtime_error("Value not found");
 
         return index;
     }
-    const T& getValAtIndex(size_t index)const 
+    const T& getValAtIndex(size_t index)const
     {
         if (!checkValuesBounds(index))
             throw std::out_of_range("Attempt to get a value with an invalid index");
-        return this->values[index].data;
+        return this->keys[index];
     }
-    const std::shared_ptr<BTreeNode<T>>& getChildAtIndex(size_t index) const 
+    BTreeNode<T, t, OrderStatistics>* getChildAtIndex(size_t index) const
     {
         if (!checkChildrenBounds(index))
             throw std::out_of_range("Attempt to get a child with an invalid index");
 
         return this->children[index];
     }
-    size_t getChildrenCount()const 
+    size_t getChildrenCount()const
+    {
+        return this->children_count;
+    }
+    size_t getValsCount()const
     {
-        return this->children.size();
+        return this->vals_count;
     }
-    size_t getValsCount()const 
+    size_t getSubtreeSize()const requires OrderStatistics
     {
-        return this->values.size();
+        return this->subtree_size;
     }
-    void increaseEntryCount(size_t index) 
+    void increaseEntryCount(size_t index)
     {
         if (!checkValuesBounds(index))
             throw std::length_error("Value index is out of range");
-        this->values[index].count++;
+        this->counts[index]++;
     }
-    size_t getEntryCount(size_t index) const 
+    size_t getEntryCount(size_t index) const
     {
         if (!checkValuesBounds(index))
             throw std::length_error("Value index is out of range");
-        return this->values[index].count;
+        return this->counts[index];
+    }
+    /*
+    Walks the subtree and throws std::logic_error at the first broken invariant: the value bounds, the order of
+    the values inside the range the ancestors leave, the child links back to their parent and slot, the leaf depth
+    and, with OrderStatistics, the subtree sizes. Returns the number of values in the subtree, duplicates included.
+    */
+    size_t checkSubtree(const T* lower, const T* upper, size_t max_vals, size_t depth, size_t& leaf_depth)const;
+    // ask the cache for what a search of this node reads: the keys and the counters behind the arrays
+    void prefetch()const
+    {
+        constexpr size_t MaxKeyLines = 16;
+        constexpr size_t KeyLines = std::min((sizeof(this->keys) + CacheLineSize - 1) / CacheLineSize, MaxKeyLines);
+        const char* first = reinterpret_cast<const char*>(this->keys.data());
+        for (size_t line = 0; line < KeyLines; line++)
+            node_search::prefetch(first + line * CacheLineSize);
+        node_search::prefetch(&this->vals_count);
+        node_search::prefetch(&this->is_leaf);
+    }
+    void prefetchChild(size_t index)const
+    {
+        node_search::prefetch(&this->children[index]);
+    }
+    // the bulk loader fills fresh nodes from left to right, the caller keeps the values sorted
+    void appendEntry(T&& val, size_t count)
+    {
+        if (this->vals_count == MaxVals)
+            throw std::length_error("Attempt to append a value to a full node");
+        this->keys[this->vals_count] = std::move(val);
+        this->counts[this->vals_count] = count;
+        this->vals_count++;
+        if constexpr (OrderStatistics)
+            this->subtree_size += count;
+    }
+    void appendChild(BTreeNode<T, t, OrderStatistics>* child)
+    {
+        if (this->is_leaf || this->children_count == MaxChildren)
+            throw std::length_error("Attempt to append a child to a leaf or a full node");
+        this->children[this->children_count++] = child;
+        this->adoptChildren(this->children_count - 1, this->children_count);
+        if constexpr (OrderStatistics)
+            this->subtree_size += child->subtree_size;
     }
 private:
     void splitRoot();
     void splitNode();
-    static void updateParent(std::vector<std::shared_ptr<BTreeNode<T>>>& children,
-        std::weak_ptr<BTreeNode<T>> new_parent) 
+    // shift the values from index on one slot to the right and put the entry into the gap
+    void insertEntry(size_t index, T val, size_t count)
     {
-        for (std::shared_ptr<BTreeNode<T>> c : children)
-            c->parent = new_parent;
+        std::move_backward(this->keys.begin() + index, this->keys.begin() + this->vals_count,
+                           this->keys.begin() + this->vals_count + 1);
+        std::move_backward(this->counts.begin() + index, this->counts.begin() + this->vals_count,
+                           this->counts.begin() + this->vals_count + 1);
+        this->keys[index] = std::move(val);
+        this->counts[index] = count;
+        this->vals_count++;
     }
-    size_t getChildIndex(const std::shared_ptr<BTreeNode<T>>& child) 
+    void eraseEntry(size_t index)
     {
-        auto it = std::find(this->children.begin(), this->children.end(), child);
+        std::move(this->keys.begin() + index + 1, this->keys.begin() + this->vals_count, this->keys.begin() + index);
+        std::move(this->counts.begin() + index + 1, this->counts.begin() + this->vals_count, this->counts.begin() + index);
+        this->vals_count--;
+    }
+    void insertChild(size_t index, BTreeNode<T, t, OrderStatistics>* child)
+    {
+        std::move_backward(this->children.begin() + index, this->children.begin() + this->children_count,
+                           this->children.begin() + this->children_count + 1);
+        this->children[index] = child;
+        this->children_count++;
+        this->adoptChildren(index, this->children_count);
+    }
+    void eraseChild(size_t index)
+    {
+        std::move(this->children.begin() + index + 1, this->children.begin() + this->children_count,
+                  this->children.begin() + index);
+        this->children_count--;
+        this->adoptChildren(index, this->children_count);
+    }
+    // move count entries (and the count + 1 children around them, if any) from the source to the end of this node
+    void appendFrom(BTreeNode<T, t, OrderStatistics>* source, size_t first, size_t count)
+    {
+        std::move(source->keys.begin() + first, source->keys.begin() + first + count,
+                  this->keys.begin() + this->vals_count);
+        std::copy(source->counts.begin() + first, source->counts.begin() + first + count,
+                  this->counts.begin() + this->vals_count);
+        this->vals_count += count;
+        if (!source->is_leaf)
+        {
+            for (size_t i = first; i <= first + count; i++)
+                this->children[this->children_count++] = source->children[i];
+            this->adoptChildren(this->children_count - count - 1, this->children_count);
+        }
+    }
+    // point the children in [first, last) back at this node and at their slots in it
+    void adoptChildren(size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+        {
+            this->children[i]->parent = this;
+            this->children[i]->position = i;
+        }
+    }
+    // a single value was added to or taken from this node, every subtree up to the root changes by the same amount
+    void addToSubtreeSizes([[maybe_unused]] int delta)
+    {
+        if constexpr (OrderStatistics)
+            for (BTreeNode<T, t, OrderStatistics>* node = this; node; node = node->parent)
+                node->subtree_size += delta;
+    }
+    // restructuring moves entries and children between neighbours, the totals of those are summed up again
+    void recountSubtree()
+    {
+        if constexpr (OrderStatistics)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < this->vals_count; i++)
+                size += this->counts[i];
+            for (size_t i = 0; i < this->children_count; i++)
+                size += this->children[i]->subtree_size;
+            this->subtree_size = size;
+        }
+    }
+    size_t getChildIndex(const BTreeNode<T, t, OrderStatistics>* child)const
+    {
+        assert(child->parent == this && this->children[child->position] == child);
 
-        assert(it != this->children.end() && *it == child);
-     
-        return std::distance(this->children.begin(), it);
+        return child->position;
+    }
+    // counts a restructuring step in the stats of the tree, a no-op without BTREE_ENABLE_STATS
+    void countRestructuring([[maybe_unused]] size_t RestructuringCounts::* step)const
+    {
+        if constexpr (StatsEnabled)
+            (this->pool->restructurings.*step)++;
     }
-    void rotateLeft(std::shared_ptr<BTreeNode<T>>right_sibling, size_t this_index_in_parent_children);
-    void rotateRight(std::shared_ptr<BTreeNode<T>>left_sibling, size_t this_index_in_parent_children);
-    void mergeWithRight(std::shared_ptr<BTreeNode<T>>right_sibling, size_t this_index_in_parent_children);
-    void mergeWithLeft(std::shared_ptr<BTreeNode<T>>left_sibling, size_t this_index_in_parent_children);
-    void clearNode() 
+    void rotateLeft(BTreeNode<T, t, OrderStatistics>* right_sibling, size_t this_index_in_parent_children);
+    void rotateRight(BTreeNode<T, t, OrderStatistics>* left_sibling, size_t this_index_in_parent_children);
+    void mergeWithRight(BTreeNode<T, t, OrderStatistics>* right_sibling, size_t this_index_in_parent_children);
+    void mergeWithLeft(BTreeNode<T, t, OrderStatistics>* left_sibling, size_t this_index_in_parent_children);
+    void clearNode()
     {
-        this->values.clear();
-        this->children.clear();
+        this->vals_count = 0;
+        this->children_count = 0;
     }
-    bool checkValuesBounds(size_t index)const 
+    bool checkValuesBounds(size_t index)const
     {
-        return index <= this->getValsCount();
+        return index < this->getValsCount();
     }
     bool checkChildrenBounds(size_t index)const
     {
-        return index <= this->getChildrenCount();
+        return index < this->getChildrenCount();
     }
-    
-    
+
+
 };
 #include "node_impl.ipp"
 #endif
 
-
@@ -6,89 +6,72 @@
 
 
 
-template <typename T>
-void BTreeNode<T>::splitNode()
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::splitNode()
 {
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
-    {
-        size_t mid = this->values.size() / 2;
-        
-        // decouple the right part(children and values) of the current node and leave the left part intact
-        std::vector<std::shared_ptr<BTreeNode<T>>> right_child_children;
-        if (!this->is_leaf)
-            right_child_children.assign(this->children.begin() + mid + 1, this->children.end()); 
-        std::vector<Entry> right_child_vals(this->values.begin() + mid + 1, this->values.end());
-        
-        // lift the mid to the parent
-        size_t this_index_in_parent_children = parent_ptr->getChildIndex(this->shared_from_this());
-        parent_ptr->values.insert(parent_ptr->values.begin() + this_index_in_parent_children, Entry(this->values[mid]));
-
-        // remove the right part and the mid from the current node
-        this->values.erase(this->values.begin() + mid, this->values.end());
-        if (!this->is_leaf)
-            this->children.erase(this->children.begin() + mid + 1, this->children.end());
-        
-        // construct the right sibling of the current node(a new child of the parent of the current node right to the this)
-        auto parent_right_child = std::make_shared<BTreeNode<T>>(this->t, std::move(right_child_vals),
-                                                                 std::move(right_child_children),
-                                                                 this->parent, false, this->is_leaf);
-        updateParent(parent_right_child->children, parent_right_child);
-        parent_ptr->children.insert(parent_ptr->children.begin() + this_index_in_parent_children + 1,
-                                      parent_right_child); // add the right sibling right to the current node in the parent's children
-    }
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
+        parent_ptr->splitChild(parent_ptr->getChildIndex(this));
     else
-    {
         throw std::runtime_error("splitNode called on an invalid parent");
-    }
 }
-template <typename T>
-void BTreeNode<T>::splitRoot()
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::splitChild(size_t index)
 {
-    size_t mid = this->values.size() / 2;
-    T mid_val = this->values.at(mid).data;
-    
-    //prepare the left and right parts of the root
-    std::vector<std::shared_ptr<BTreeNode<T>>> left_child_children, right_child_children;
-    if (!this->is_leaf)
-    {
-        left_child_children.assign(this->children.begin(), this->children.begin() + mid + 1);
-        right_child_children.assign(this->children.begin() + mid + 1, this->children.end());
-    }
-    std::vector<Entry> left_child_vals(this->values.begin(), this->values.begin() + mid);
-    std::vector<Entry> right_child_vals(this->values.begin() + mid + 1, this->values.end());
-    
+    BTreeNode<T, t, OrderStatistics>* child = this->getChildAtIndex(index);
+    size_t mid = child->vals_count / 2;
+    this->countRestructuring(&RestructuringCounts::split);
+
+    // construct the right sibling of the child(a new child of this node right to the child)
+    // and move the right part(children and values) of the child into it, leaving the left part intact
+    auto right_child = this->pool->create(this->pool, this, false, child->is_leaf);
+    right_child->appendFrom(child, mid + 1, child->vals_count - mid - 1);
+
+    // lift the mid to this node
+    this->insertEntry(index, std::move(child->keys[mid]), child->counts[mid]);
+
+    // remove the right part and the mid from the child
+    child->vals_count = mid;
+    if (!child->is_leaf)
+        child->children_count = mid + 1;
+
+    this->insertChild(index + 1, right_child); // add the right sibling right to the child in the children of this node
+    right_child->recountSubtree();
+    child->recountSubtree();
+}
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::splitRoot()
+{
+    size_t mid = this->vals_count / 2;
+    this->countRestructuring(&RestructuringCounts::split_root);
 
-    this->clearNode();
-    
     // construct the left and right children of the root from the parts
-    auto new_left_child =
-        std::make_shared<BTreeNode<T>>(this->t, std::move(left_child_vals),
-                                       std::move(left_child_children),
-                                       this->weak_from_this(), false,
-                                       this->is_leaf);
-    auto new_right_child =
-        std::make_shared<BTreeNode<T>>(this->t, std::move(right_child_vals),
-                                       std::move(right_child_children),
-                                       this->weak_from_this(), false,
-                                       this->is_leaf);
-    updateParent(new_left_child->children, new_left_child);
-    updateParent(new_right_child->children, new_right_child);
-
-   
-    this->children = {new_left_child, new_right_child};
-    this->values = {Entry(mid_val)}; // leave the middle intact(was removed after calling clearNode())
+    auto new_left_child = this->pool->create(this->pool, this, false, this->is_leaf);
+    auto new_right_child = this->pool->create(this->pool, this, false, this->is_leaf);
+    new_left_child->appendFrom(this, 0, mid);
+    new_right_child->appendFrom(this, mid + 1, this->vals_count - mid - 1);
+
+    // leave the middle as the only value of the root, the whole entry is kept so the duplicate count survives the split
+    this->keys[0] = std::move(this->keys[mid]);
+    this->counts[0] = this->counts[mid];
+    this->vals_count = 1;
+    this->children[0] = new_left_child;
+    this->children[1] = new_right_child;
+    this->children_count = 2;
+    this->adoptChildren(0, 2);
+    new_left_child->recountSubtree();
+    new_right_child->recountSubtree();
     this->is_leaf = false; // the root is not a leaf anymore
     // NOTE: this methods leaves the root pointer intact, so the reassignment in the actual Tree class is unnecessary
 }
 
 
 
-template <typename T>
-void BTreeNode<T>::split()
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::split()
 {
-    if (this->values.size() < 2 * this->t- 1)
+    if (this->vals_count < 2 * t - 1)
         return;
-    
+
     if (this->is_root)
     {
         this->splitRoot();
@@ -96,76 +79,75 @@ void BTreeNode<T>::split()
     else
     {
         this->splitNode();
-        if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+        if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
             parent_ptr->split();
         else
             throw std::runtime_error("Split called on node with empty or expired parent");
     }
-    
+
 }
 
-template <typename T>
-void BTreeNode<T>::fixUnderflow()
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::fixUnderflow()
 {
-    if (this->values.size() >= t - 1 || (this->is_root && this->values.size() > 0)) // the node is valid
+    if (this->vals_count >= t - 1 || (this->is_root && this->vals_count > 0)) // the node is valid
     {
         return;
     }
     else if (this->is_root)
     {
-        this->is_leaf = true; // underflow in root causes merge with child and leaves only the root as the only node in a B-Tree 
-        
-        if (this->children.empty())
+        this->is_leaf = true; // underflow in root causes merge with child and leaves only the root as the only node in a B-Tree
+
+        if (this->children_count == 0)
             return;
         // underflow in root can occur with only one child
-        assert(this->children.size() == 1);
-        std::shared_ptr<BTreeNode<T>> child = this->children.front();
+        assert(this->children_count == 1);
+        BTreeNode<T, t, OrderStatistics>* child = this->children[0];
 
-        this->values = child->values;
-        this->children = child->children;
-        updateParent(this->children, this->weak_from_this());
+        this->clearNode();
         this->is_leaf = child->is_leaf;
-        child->clearNode();
-        
+        this->appendFrom(child, 0, child->vals_count);
+        this->pool->destroy(child); // the collapsed child is recycled by the pool
+
         return ;
     }
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
     {
-        size_t this_index_in_parent_children = parent_ptr->getChildIndex(this->shared_from_this());
-        
-        
-        std::shared_ptr<BTreeNode<T>>right_sibling{nullptr}, left_sibling{nullptr};
-        
-        if (this_index_in_parent_children < parent_ptr->children.size() - 1)
-            right_sibling = parent_ptr->children.at(this_index_in_parent_children + 1);
-        
+        size_t this_index_in_parent_children = parent_ptr->getChildIndex(this);
+
+
+        BTreeNode<T, t, OrderStatistics>* right_sibling{nullptr}, *left_sibling{nullptr};
+
+        if (this_index_in_parent_children < parent_ptr->children_count - 1)
+            right_sibling = parent_ptr->children[this_index_in_parent_children + 1];
+
         if (this_index_in_parent_children > 0)
-            left_sibling = parent_ptr->children.at(this_index_in_parent_children - 1);
-        
+            left_sibling = parent_ptr->children[this_index_in_parent_children - 1];
+
         if (left_sibling && right_sibling)
         {
-            if (left_sibling->values.size() >= t) 
+            if (left_sibling->vals_count >= t)
                 this->rotateRight(left_sibling, this_index_in_parent_children); // can borrow from the left sibling
-            else if (right_sibling->values.size() >= t) 
+            else if (right_sibling->vals_count >= t)
                 this->rotateLeft(right_sibling, this_index_in_parent_children); // can borrow from the right sibling
             else
                 this->mergeWithRight(right_sibling, this_index_in_parent_children); // both siblings don't have enough elements to share
         }
         else if (left_sibling)
         {
-            if (left_sibling->values.size() >= t)
+            if (left_sibling->vals_count >= t)
                 this->rotateRight(left_sibling, this_index_in_parent_children); // can borrow from the left sibling
             else
                 this->mergeWithLeft(left_sibling, this_index_in_parent_children); // left sibling don't have enough elements to share
         }
         else if (right_sibling)
         {
-            if (right_sibling->values.size() >= t)
+            if (right_sibling->vals_count >= t)
                 this->rotateLeft(right_sibling, this_index_in_parent_children); // can borrow from the right sibling
             else
                 this->mergeWithRight(right_sibling, this_index_in_parent_children); // right sibling don't have enough elements to share
         }
-        
+
         parent_ptr->fixUnderflow();
     }
     else
@@ -174,33 +156,58 @@ void BTreeNode<T>::fixUnderflow()
     }
 }
 
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::refillChild(size_t index)
+{
+    BTreeNode<T, t, OrderStatistics>* child = this->getChildAtIndex(index);
+    BTreeNode<T, t, OrderStatistics>* left_sibling = index > 0 ? this->children[index - 1] : nullptr;
+    BTreeNode<T, t, OrderStatistics>* right_sibling = index + 1 < this->children_count ? this->children[index + 1] : nullptr;
+
+    // the same preference as in fixUnderflow: borrow from the left, then from the right, merge otherwise
+    if (left_sibling && left_sibling->vals_count >= t)
+        child->rotateRight(left_sibling, index);
+    else if (right_sibling && right_sibling->vals_count >= t)
+        child->rotateLeft(right_sibling, index);
+    else if (right_sibling)
+        child->mergeWithRight(right_sibling, index);
+    else
+        child->mergeWithLeft(left_sibling, index);
+
+    // the only separator of the root went down into the merged child, which collapses into the root
+    if (this->is_root && this->vals_count == 0)
+        this->fixUnderflow();
+}
+
 // Perform clockwise rotation considering the current node a center
-template <typename T>
-void BTreeNode<T>::rotateRight(std::shared_ptr<BTreeNode<T>>left_sibling, size_t this_index_in_parent_children)
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::rotateRight(BTreeNode<T, t, OrderStatistics>* left_sibling, size_t this_index_in_parent_children)
 {
     if (this_index_in_parent_children < 1)
         throw std::runtime_error("rotateRight called on most left node");
-    
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
     {
-        /* Since in a correct node every node has one more child than values the index of the current node 
+        /* Since in a correct node every node has one more child than values the index of the current node
         in parent's children is shifted on 1 to the right.
-        So, to borrow the separator between the current node(located to the right of the separator) and 
+        So, to borrow the separator between the current node(located to the right of the separator) and
         it's left sibling 1 must be subtracted from the index current node's index in parent's children vector
-        */ 
-        T parent_val = parent_ptr->values.at(this_index_in_parent_children - 1).data; 
-        this->values.insert(std::lower_bound(this->values.begin(), this->values.end(),parent_val), Entry(parent_val)); // borrow the separator from the parent
-        
-        parent_ptr->values.at(this_index_in_parent_children - 1) = left_sibling->values.back(); // a "donor" element from the left sibling becomes a new separator
-        left_sibling->values.pop_back();
+        */
+        size_t separator = this_index_in_parent_children - 1;
+        this->countRestructuring(&RestructuringCounts::rotate_right);
+        this->insertEntry(0, std::move(parent_ptr->keys[separator]), parent_ptr->counts[separator]); // borrow the separator from the parent
+
+        size_t donor = left_sibling->vals_count - 1;
+        parent_ptr->keys[separator] = std::move(left_sibling->keys[donor]); // a "donor" element from the left sibling becomes a new separator
+        parent_ptr->counts[separator] = left_sibling->counts[donor];
+        left_sibling->vals_count--;
 
         if (!left_sibling->is_leaf)
         {
-            this->children.insert(this->children.begin(), left_sibling->children.back()); // attach the child from the "donor" element to the current node
-
-            this->children.front()->parent = this->shared_from_this();
-            left_sibling->children.pop_back();
+            this->insertChild(0, left_sibling->children[left_sibling->children_count - 1]); // attach the child from the "donor" element to the current node
+            left_sibling->children_count--;
         }
+        this->recountSubtree();
+        left_sibling->recountSubtree();
     }
     else
     {
@@ -209,79 +216,95 @@ void BTreeNode<T>::rotateRight(std::shared_ptr<BTreeNode<T>>left_sibling, size_t
 }
 
 // Perform counterclockwise rotation considering the current node a center
-template <typename T>
-void BTreeNode<T>::rotateLeft(std::shared_ptr<BTreeNode<T>>right_sibling, size_t this_index_in_parent_children){
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::rotateLeft(BTreeNode<T, t, OrderStatistics>* right_sibling, size_t this_index_in_parent_children){
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
     {
 
 
         /*
-        Since in a correct node every node has one more child than values 
+        Since in a correct node every node has one more child than values
         the index of the current node in parent's children is shifted on 1 to the right.
-        So, to borrow the separator between the current node(located to the left of the separator) 
+        So, to borrow the separator between the current node(located to the left of the separator)
         and it's right sibling nothing must be subtracted from the index current node's index in parent's children vector
-        */ 
-        T parent_val = parent_ptr->values.at(this_index_in_parent_children).data; 
-        this->values.insert(std::lower_bound(this->values.begin(), this->values.end(),
-                                             parent_val), Entry(parent_val)); // borrow the separator from the parent
-        
-        parent_ptr->values.at(this_index_in_parent_children) = right_sibling->values.front(); // a "donor" element from the right sibling becomes a new separator
-        
-        right_sibling->values.erase(right_sibling->values.begin());
+        */
+        size_t separator = this_index_in_parent_children;
+        this->countRestructuring(&RestructuringCounts::rotate_left);
+        this->insertEntry(this->vals_count, std::move(parent_ptr->keys[separator]),
+                          parent_ptr->counts[separator]); // borrow the separator from the parent
+
+        parent_ptr->keys[separator] = std::move(right_sibling->keys[0]); // a "donor" element from the right sibling becomes a new separator
+        parent_ptr->counts[separator] = right_sibling->counts[0];
+
+        right_sibling->eraseEntry(0);
         if (!right_sibling->is_leaf)
         {
-            this->children.push_back(right_sibling->children.front()); // attach the child from the "donor" element to the current node
-            this->children.back()->parent = this->shared_from_this();
-            right_sibling->children.erase(right_sibling->children.begin());
+            this->insertChild(this->children_count, right_sibling->children[0]); // attach the child from the "donor" element to the current node
+            right_sibling->eraseChild(0);
         }
-        
+        this->recountSubtree();
+        right_sibling->recountSubtree();
+
     }
     else
     {
         throw std::runtime_error("rotateLeft called on node with empty or expired parent");
     }
 }
-template <typename T>
-void BTreeNode<T>::mergeWithRight(std::shared_ptr<BTreeNode<T>>right_sibling, size_t index)
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::mergeWithRight(BTreeNode<T, t, OrderStatistics>* right_sibling, size_t index)
 {
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
     {
-        this->values.push_back(parent_ptr->values.at(index));
-        parent_ptr->values.erase(parent_ptr->values.begin() + index);
-        
-        std::move(right_sibling->values.begin(), right_sibling->values.end(),
-                  std::back_inserter(this->values));
-        std::move(right_sibling->children.begin(), right_sibling->children.end(),
-                  std::back_inserter(this->children));
-        updateParent(this->children, this->weak_from_this());
-        
-        right_sibling->clearNode();
-        
-        parent_ptr->children.erase(parent_ptr->children.begin() + index + 1);
+        this->countRestructuring(&RestructuringCounts::merge_with_right);
+        this->insertEntry(this->vals_count, std::move(parent_ptr->keys[index]), parent_ptr->counts[index]);
+        parent_ptr->eraseEntry(index);
+
+        this->appendFrom(right_sibling, 0, right_sibling->vals_count);
+        this->recountSubtree();
+
+        this->pool->destroy(right_sibling); // the emptied sibling is recycled by the pool
+
+        parent_ptr->eraseChild(index + 1);
     }
     else
     {
         throw std::runtime_error("mergeWithRight called on node with empty or expired parent");
     }
 }
-template <typename T>
-void BTreeNode<T>::mergeWithLeft(std::shared_ptr<BTreeNode<T>>left_sibling, size_t index)
+template <typename T, size_t t, bool OrderStatistics>
+void BTreeNode<T, t, OrderStatistics>::mergeWithLeft(BTreeNode<T, t, OrderStatistics>* left_sibling, size_t index)
 {
     if (index < 1)
         throw std::runtime_error("mergeWithLeft called on most left node");
-    
-    if (std::shared_ptr<BTreeNode<T>> parent_ptr = this->parent.lock())
+
+    if (BTreeNode<T, t, OrderStatistics>* parent_ptr = this->parent)
     {
-        this->values.insert(this->values.begin(), parent_ptr->values.at(index - 1));
-        parent_ptr->values.erase(parent_ptr->values.begin() + index - 1);
-        
-        this->values.insert(this->values.begin(), std::make_move_iterator(left_sibling->values.begin()), std::make_move_iterator(left_sibling->values.end()));
-        this->children.insert(this->children.begin(), std::make_move_iterator(left_sibling->children.begin()), std::make_move_iterator(left_sibling->children.end()));
-        updateParent(this->children, this->weak_from_this());
-        
-        left_sibling->clearNode();
-        
-        parent_ptr->children.erase(parent_ptr->children.begin() + index - 1);
+        this->countRestructuring(&RestructuringCounts::merge_with_left);
+        // make room at the front for the values of the left sibling followed by the separator
+        size_t shift = left_sibling->vals_count + 1;
+        std::move_backward(this->keys.begin(), this->keys.begin() + this->vals_count,
+                           this->keys.begin() + this->vals_count + shift);
+        std::move_backward(this->counts.begin(), this->counts.begin() + this->vals_count,
+                           this->counts.begin() + this->vals_count + shift);
+        std::move(left_sibling->keys.begin(), left_sibling->keys.begin() + left_sibling->vals_count, this->keys.begin());
+        std::copy(left_sibling->counts.begin(), left_sibling->counts.begin() + left_sibling->vals_count, this->counts.begin());
+        this->keys[shift - 1] = std::move(parent_ptr->keys[index - 1]);
+        this->counts[shift - 1] = parent_ptr->counts[index - 1];
+        this->vals_count += shift;
+        parent_ptr->eraseEntry(index - 1);
+
+        std::move_backward(this->children.begin(), this->children.begin() + this->children_count,
+                           this->children.begin() + this->children_count + left_sibling->children_count);
+        std::copy(left_sibling->children.begin(), left_sibling->children.begin() + left_sibling->children_count,
+                  this->children.begin());
+        this->children_count += left_sibling->children_count;
+        this->adoptChildren(0, this->children_count);
+        this->recountSubtree();
+
+        this->pool->destroy(left_sibling); // the emptied sibling is recycled by the pool
+
+        parent_ptr->eraseChild(index - 1);
     }
     else
     {
@@ -292,5 +315,48 @@ void BTreeNode<T>::mergeWithLeft(std::shared_ptr<BTreeNode<T>>left_sibling, size
 
 
 
+template <typename T, size_t t, bool OrderStatistics>
+size_t BTreeNode<T, t, OrderStatistics>::checkSubtree(const T* lower, const T* upper, size_t max_vals, size_t depth,
+                                                      size_t& leaf_depth)const
+{
+    auto require = [depth](bool holds, const char* invariant)
+    {
+        if (!holds)
+            throw std::logic_error(std::format("B-tree invariant broken at depth {}: {}", depth, invariant));
+    };
+    require(this->is_root == (depth == 1) && (this->parent == nullptr) == this->is_root,
+            "only the top node is a root without a parent");
+    require(this->is_root || this->vals_count >= t - 1, "a node holds fewer than t - 1 values");
+    require(this->vals_count <= max_vals, "a node holds more values than the restructuring allows");
+    require(this->is_leaf || this->vals_count > 0, "an inner node holds no values");
+    require(this->children_count == (this->is_leaf ? 0 : this->vals_count + 1),
+            "the number of children does not match the number of values");
+
+    size_t size = 0;
+    for (size_t i = 0; i < this->vals_count; i++)
+    {
+        require(i == 0 || this->keys[i - 1] < this->keys[i], "the values of a node are not strictly increasing");
+        require((!lower || *lower < this->keys[i]) && (!upper || this->keys[i] < *upper),
+                "a value lies outside the range its ancestors leave for it");
+        require(this->counts[i] > 0, "an entry holds no copies of its value");
+        size += this->counts[i];
+    }
+    if (this->is_leaf)
+    {
+        if (leaf_depth == 0)
+            leaf_depth = depth;
+        require(depth == leaf_depth, "the leaves are not all at the same depth");
+    }
+    for (size_t i = 0; i < this->children_count; i++)
+    {
+        const BTreeNode<T, t, OrderStatistics>* child = this->children[i];
+        require(child->parent == this && child->position == i, "a child does not point back at its parent and slot");
+        size += child->checkSubtree(i > 0 ? &this->keys[i - 1] : lower, i < this->vals_count ? &this->keys[i] : upper,
+                                    max_vals, depth + 1, leaf_depth);
+    }
+    if constexpr (OrderStatistics)
+        require(this->subtree_size == size, "a subtree size differs from the number of values below the node");
+    return size;
+}
 
 #endif
@@ -0,0 +1,98 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+/*
+Slab allocator for tree nodes.
+Nodes are carved out of contiguous slabs of SlabNodes slots, so a tree with millions of nodes
+performs one allocator call per slab instead of one per node. Slots released by destroy() are
+kept on an intrusive free list and handed out again by the next create().
+The pool owns the raw memory only: destroying the live nodes is the job of the owning tree.
+*/
+template <typename Node, size_t SlabNodes = 512>
+class NodePool
+{
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(Node) std::byte storage[sizeof(Node)];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    Slot* free_list;
+    size_t used_in_last_slab;
+    size_t live_nodes;
+
+public:
+    NodePool() : slabs(), free_list(nullptr), used_in_last_slab(SlabNodes), live_nodes(0) {}
+    ~NodePool() = default;
+    NodePool(NodePool&& other) = delete;
+    NodePool& operator=(NodePool&& other) = delete;
+    NodePool(const NodePool& other) = delete;
+    NodePool& operator=(const NodePool& other) = delete;
+
+    template <typename... Args>
+    Node* create(Args&&... args)
+    {
+        Slot* slot = this->acquireSlot();
+        try
+        {
+            Node* node = ::new (static_cast<void*>(slot->storage)) Node(std::forward<Args>(args)...);
+            this->live_nodes++;
+            return node;
+        }
+        catch (...)
+        {
+            this->releaseSlot(slot);
+            throw;
+        }
+    }
+    void destroy(Node* node)
+    {
+        if (!node)
+            return;
+        node->~Node();
+        this->releaseSlot(reinterpret_cast<Slot*>(node));
+        this->live_nodes--;
+    }
+    size_t getLiveCount()const
+    {
+        return this->live_nodes;
+    }
+    size_t getCapacity()const
+    {
+        return this->slabs.size() * SlabNodes;
+    }
+    size_t getReservedBytes()const
+    {
+        return this->slabs.size() * SlabNodes * sizeof(Slot);
+    }
+private:
+    Slot* acquireSlot()
+    {
+        if (this->free_list)
+        {
+            Slot* slot = this->free_list;
+            this->free_list = slot->next;
+            return slot;
+        }
+        if (this->used_in_last_slab == SlabNodes)
+        {
+            this->slabs.push_back(std::make_unique_for_overwrite<Slot[]>(SlabNodes));
+            this->used_in_last_slab = 0;
+        }
+        return &this->slabs.back()[this->used_in_last_slab++];
+    }
+    void releaseSlot(Slot* slot)
+    {
+        slot->next = this->free_list;
+        this->free_list = slot;
+    }
+};
+#endif
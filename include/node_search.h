@@ -0,0 +1,231 @@
+#ifndef NODE_SEARCH_H
+#define NODE_SEARCH_H
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+    #define BTREE_SEARCH_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define BTREE_SEARCH_SSE2 1
+#endif
+#if defined(__SSE4_2__) || defined(__AVX2__)
+    #define BTREE_SEARCH_SSE42 1
+#endif
+#if defined(BTREE_SEARCH_AVX2) || defined(BTREE_SEARCH_SSE2)
+    #include <immintrin.h>
+#endif
+
+
+inline constexpr size_t CacheLineSize = 64;
+
+/*
+Lower bound search inside a single node.
+Keys of arithmetic types are compared branch-free: every key of the searched window is compared
+against the needle at once and the number of smaller keys is the lower bound. With AVX2 or SSE2
+available the comparisons run on whole vector registers, otherwise a scalar counting loop is used.
+Nodes wider than a couple of cache lines are first narrowed down by a branch-free binary search.
+Any other key type falls back to std::lower_bound.
+*/
+namespace node_search
+{
+#if defined(BTREE_SEARCH_AVX2)
+    inline constexpr size_t VectorBytes = 32;
+#elif defined(BTREE_SEARCH_SSE2)
+    inline constexpr size_t VectorBytes = 16;
+#else
+    inline constexpr size_t VectorBytes = 0;
+#endif
+
+#if defined(BTREE_SEARCH_SSE42)
+    inline constexpr bool HasInt64Compare = true;
+#else
+    inline constexpr bool HasInt64Compare = false;
+#endif
+
+    template <typename T>
+    inline constexpr bool IsVectorKey = VectorBytes > 0 && std::is_arithmetic_v<T> && !std::is_same_v<T, bool> &&
+                                        (sizeof(T) == 4 || sizeof(T) == 8) &&
+                                        (std::is_floating_point_v<T> || sizeof(T) == 4 || HasInt64Compare);
+
+    // vector loads may read up to one register past the last key, so key arrays are padded by that much
+    template <typename T, size_t Capacity>
+    inline constexpr size_t PaddedCapacity = IsVectorKey<T> ? Capacity + VectorBytes / sizeof(T) : Capacity;
+
+    template <typename T>
+    inline constexpr size_t LinearWindow = std::max<size_t>(2 * CacheLineSize / sizeof(T), 8);
+
+    template <typename T>
+    size_t countLessScalar(const T* keys, size_t n, const T& val)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++)
+            count += static_cast<size_t>(keys[i] < val);
+        return count;
+    }
+
+    // mask of the lanes of the chunk starting at i that still hold keys
+    inline unsigned tailMask(size_t n, size_t i, size_t lanes)
+    {
+        size_t remaining = n - i;
+        return remaining >= lanes ? (1u << lanes) - 1 : (1u << remaining) - 1;
+    }
+
+    // compare masks have at most 8 lanes; without a popcnt instruction std::popcount becomes a library call
+    inline size_t laneCount(unsigned mask)
+    {
+#if defined(__POPCNT__)
+        return static_cast<size_t>(std::popcount(mask));
+#else
+        mask = mask - ((mask >> 1) & 0x55u);
+        mask = (mask & 0x33u) + ((mask >> 2) & 0x33u);
+        return static_cast<size_t>((mask + (mask >> 4)) & 0x0Fu);
+#endif
+    }
+
+#if defined(BTREE_SEARCH_AVX2)
+    template <typename T>
+    size_t countLessVector(const T* keys, size_t n, const T& val)
+    {
+        constexpr size_t Lanes = 32 / sizeof(T);
+        size_t count = 0;
+        if constexpr (std::is_floating_point_v<T> && sizeof(T) == 4)
+        {
+            const __m256 needle = _mm256_set1_ps(val);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m256 less = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), needle, _CMP_LT_OQ);
+                count += laneCount(static_cast<unsigned>(_mm256_movemask_ps(less)) & tailMask(n, i, Lanes));
+            }
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            const __m256d needle = _mm256_set1_pd(val);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m256d less = _mm256_cmp_pd(_mm256_loadu_pd(keys + i), needle, _CMP_LT_OQ);
+                count += laneCount(static_cast<unsigned>(_mm256_movemask_pd(less)) & tailMask(n, i, Lanes));
+            }
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            // unsigned keys are biased into the signed range, the only one the compare instruction knows
+            const __m256i bias = _mm256_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+            const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32(std::bit_cast<int32_t>(val)), bias);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m256i chunk = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias);
+                __m256i less = _mm256_cmpgt_epi32(needle, chunk);
+                count += laneCount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(less))) & tailMask(n, i, Lanes));
+            }
+        }
+        else
+        {
+            const __m256i bias = _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+            const __m256i needle = _mm256_xor_si256(_mm256_set1_epi64x(std::bit_cast<int64_t>(val)), bias);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m256i chunk = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias);
+                __m256i less = _mm256_cmpgt_epi64(needle, chunk);
+                count += laneCount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(less))) & tailMask(n, i, Lanes));
+            }
+        }
+        return count;
+    }
+#elif defined(BTREE_SEARCH_SSE2)
+    template <typename T>
+    size_t countLessVector(const T* keys, size_t n, const T& val)
+    {
+        constexpr size_t Lanes = 16 / sizeof(T);
+        size_t count = 0;
+        if constexpr (std::is_floating_point_v<T> && sizeof(T) == 4)
+        {
+            const __m128 needle = _mm_set1_ps(val);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m128 less = _mm_cmplt_ps(_mm_loadu_ps(keys + i), needle);
+                count += laneCount(static_cast<unsigned>(_mm_movemask_ps(less)) & tailMask(n, i, Lanes));
+            }
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            const __m128d needle = _mm_set1_pd(val);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m128d less = _mm_cmplt_pd(_mm_loadu_pd(keys + i), needle);
+                count += laneCount(static_cast<unsigned>(_mm_movemask_pd(less)) & tailMask(n, i, Lanes));
+            }
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            const __m128i bias = _mm_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+            const __m128i needle = _mm_xor_si128(_mm_set1_epi32(std::bit_cast<int32_t>(val)), bias);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m128i chunk = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias);
+                __m128i less = _mm_cmpgt_epi32(needle, chunk);
+                count += laneCount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(less))) & tailMask(n, i, Lanes));
+            }
+        }
+        else
+        {
+    #if defined(BTREE_SEARCH_SSE42)
+            const __m128i bias = _mm_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+            const __m128i needle = _mm_xor_si128(_mm_set1_epi64x(std::bit_cast<int64_t>(val)), bias);
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                __m128i chunk = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias);
+                __m128i less = _mm_cmpgt_epi64(needle, chunk);
+                count += laneCount(static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(less))) & tailMask(n, i, Lanes));
+            }
+    #endif
+        }
+        return count;
+    }
+#endif
+
+    template <typename T>
+    size_t countLess(const T* keys, size_t n, const T& val)
+    {
+        if constexpr (IsVectorKey<T>)
+            return countLessVector(keys, n, val);
+        else
+            return countLessScalar(keys, n, val);
+    }
+
+    // hint the cache to load the line holding address, without any effect where the compiler offers no prefetch
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#elif defined(BTREE_SEARCH_SSE2)
+        _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+    }
+
+    // index of the first of the n sorted keys that is not less than val
+    template <typename T>
+    size_t lowerBound(const T* keys, size_t n, const T& val)
+    {
+        if constexpr (std::is_arithmetic_v<T>)
+        {
+            const T* first = keys;
+            size_t len = n;
+            while (len > LinearWindow<T>)
+            {
+                size_t half = len / 2;
+                first = first[half - 1] < val ? first + half : first;
+                len -= half;
+            }
+            return static_cast<size_t>(first - keys) + countLess(first, len, val);
+        }
+        else
+        {
+            return static_cast<size_t>(std::lower_bound(keys, keys + n, val) - keys);
+        }
+    }
+}
+#endif
@@ -0,0 +1,82 @@
+#ifndef OPTIMISTIC_LATCH_H
+#define OPTIMISTIC_LATCH_H
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <immintrin.h>
+#endif
+
+
+/*
+Version latch for optimistic lock coupling.
+Readers take no lock: they remember the version, read the node and validate that the version is unchanged.
+Writers lock by setting the locked bit, unlocking bumps the version so every reader that overlapped the write fails
+its validation. A node unlinked from the tree is unlocked as obsolete and never becomes readable again.
+Layout of the word: bit 0 obsolete, bit 1 locked, the rest is the version counter.
+*/
+class OptimisticLatch
+{
+    static constexpr uint64_t ObsoleteBit = 0b01;
+    static constexpr uint64_t LockedBit = 0b10;
+    static constexpr unsigned SpinsBeforeYield = 64; // a writer holds a latch for a few hundred cycles at most
+
+    std::atomic<uint64_t> word;
+
+public:
+    OptimisticLatch() : word(0) {}
+
+    // wait for a writer to leave and remember the version, false if the node was unlinked
+    bool readLock(uint64_t& version)const
+    {
+        version = this->word.load(std::memory_order_acquire);
+        for (unsigned spins = 1; version & LockedBit; spins++)
+        {
+            // with more threads than cores the writer may be descheduled, give it the core instead of spinning on
+            if (spins % SpinsBeforeYield == 0)
+                std::this_thread::yield();
+            else
+                pause();
+            version = this->word.load(std::memory_order_acquire);
+        }
+        return !(version & ObsoleteBit);
+    }
+    // true if nothing was written since readLock returned the version, everything read in between is consistent
+    bool validate(uint64_t version)const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return this->word.load(std::memory_order_relaxed) == version;
+    }
+    // turn a read into a write lock, fails if anything was written since the version was taken
+    bool tryUpgrade(uint64_t version)
+    {
+        if (!this->word.compare_exchange_strong(version, version + LockedBit, std::memory_order_acquire))
+            return false;
+        // a reader that sees any of the writes that follow must also see the locked bit when it validates
+        std::atomic_thread_fence(std::memory_order_release);
+        return true;
+    }
+    bool tryWriteLock()
+    {
+        uint64_t version = this->word.load(std::memory_order_relaxed);
+        return !(version & (LockedBit | ObsoleteBit)) && this->tryUpgrade(version);
+    }
+    void writeUnlock()
+    {
+        this->word.fetch_add(LockedBit, std::memory_order_release);
+    }
+    void writeUnlockObsolete()
+    {
+        this->word.fetch_add(LockedBit | ObsoleteBit, std::memory_order_release);
+    }
+
+private:
+    static void pause()
+    {
+#if defined(__SSE2__) || defined(_M_X64)
+        _mm_pause();
+#endif
+    }
+};
+#endif
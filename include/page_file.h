@@ -0,0 +1,114 @@
+#ifndef PAGE_FILE_H
+#define PAGE_FILE_H
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/*
+Thin owner of a POSIX file descriptor for the paged storage.
+Reads and writes are positional and complete or throw, sync() makes everything written so far durable.
+A read-only file can additionally be mapped into memory as a whole.
+*/
+class PageFile
+{
+    std::string path;
+    int fd;
+    const std::byte* mapping;
+    size_t mapping_size;
+
+public:
+    PageFile(const std::string& path, bool read_only) : path(path), fd(-1), mapping(nullptr), mapping_size(0)
+    {
+        this->fd = read_only ? ::open(path.c_str(), O_RDONLY) : ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->fd < 0)
+            throw std::system_error(errno, std::generic_category(), std::format("Can not open {}", path));
+    }
+    ~PageFile()
+    {
+        if (this->mapping)
+            ::munmap(const_cast<std::byte*>(this->mapping), this->mapping_size);
+        ::close(this->fd);
+    }
+    PageFile(PageFile&& other) = delete;
+    PageFile& operator=(PageFile&& other) = delete;
+    PageFile(const PageFile& other) = delete;
+    PageFile& operator=(const PageFile& other) = delete;
+
+    void read(uint64_t offset, void* buffer, size_t size)const
+    {
+        auto bytes = static_cast<std::byte*>(buffer);
+        while (size > 0)
+        {
+            ssize_t done = ::pread(this->fd, bytes, size, static_cast<off_t>(offset));
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                throw std::system_error(done < 0 ? errno : EIO, std::generic_category(),
+                                        std::format("Short read from {} at offset {}", this->path, offset));
+            bytes += done;
+            offset += static_cast<uint64_t>(done);
+            size -= static_cast<size_t>(done);
+        }
+    }
+    void write(uint64_t offset, const void* buffer, size_t size)
+    {
+        auto bytes = static_cast<const std::byte*>(buffer);
+        while (size > 0)
+        {
+            ssize_t done = ::pwrite(this->fd, bytes, size, static_cast<off_t>(offset));
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                throw std::system_error(done < 0 ? errno : EIO, std::generic_category(),
+                                        std::format("Short write to {} at offset {}", this->path, offset));
+            bytes += done;
+            offset += static_cast<uint64_t>(done);
+            size -= static_cast<size_t>(done);
+        }
+    }
+    uint64_t size()const
+    {
+        struct stat info;
+        if (::fstat(this->fd, &info) != 0)
+            throw std::system_error(errno, std::generic_category(), std::format("Can not stat {}", this->path));
+        return static_cast<uint64_t>(info.st_size);
+    }
+    void resize(uint64_t size)
+    {
+        if (::ftruncate(this->fd, static_cast<off_t>(size)) != 0)
+            throw std::system_error(errno, std::generic_category(), std::format("Can not resize {}", this->path));
+    }
+    void sync()
+    {
+        if (::fsync(this->fd) != 0)
+            throw std::system_error(errno, std::generic_category(), std::format("Can not sync {}", this->path));
+    }
+    // ask the kernel to forget the cached pages of the file, benchmarks use it to measure cold reads
+    void dropOsCache()
+    {
+        ::posix_fadvise(this->fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    // map the whole file read-only, the mapping lives as long as this object
+    const std::byte* map()
+    {
+        if (this->mapping)
+            return this->mapping;
+        this->mapping_size = static_cast<size_t>(this->size());
+        if (this->mapping_size == 0)
+            return nullptr;
+        void* address = ::mmap(nullptr, this->mapping_size, PROT_READ, MAP_SHARED, this->fd, 0);
+        if (address == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), std::format("Can not map {}", this->path));
+        this->mapping = static_cast<const std::byte*>(address);
+        return this->mapping;
+    }
+};
+#endif
@@ -0,0 +1,174 @@
+#ifndef PAGED_TREE_H
+#define PAGED_TREE_H
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "buffer_pool.h"
+#include "node_search.h"
+
+
+namespace paged
+{
+    // a node is laid out as is in its page: the header, the children ids, the duplicate counts and the keys
+    template <typename T, size_t t>
+    struct Node
+    {
+        uint32_t is_leaf;
+        uint32_t count;
+        std::array<PageId, 2 * t> children;
+        std::array<uint64_t, 2 * t - 1> counts;
+        std::array<T, node_search::PaddedCapacity<T, 2 * t - 1>> keys;
+    };
+
+    template <typename T>
+    constexpr size_t nodeBytes(size_t t)
+    {
+        auto round_up = [](size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; };
+        size_t keys = 2 * t - 1 + (node_search::IsVectorKey<T> ? node_search::VectorBytes / sizeof(T) : 0);
+        size_t before_keys = round_up(8 + sizeof(PageId) * 2 * t + sizeof(uint64_t) * (2 * t - 1), alignof(T));
+        return round_up(before_keys + sizeof(T) * keys, std::max(alignof(T), alignof(uint64_t)));
+    }
+    // the largest minimum degree whose node still fits into a page
+    template <typename T, size_t PageSize>
+    constexpr size_t degreeFor()
+    {
+        size_t t = 2;
+        while (nodeBytes<T>(t + 1) <= PageSize)
+            t++;
+        return t;
+    }
+    template <typename T, size_t PageSize>
+    inline constexpr size_t DegreeFor = degreeFor<T, PageSize>();
+}
+
+/*
+B-tree kept in a file, one node per page, for values that can be stored as raw bytes.
+The degree defaults to the largest one whose node fits into a page. Nodes refer to their children by page id,
+pages are read through a bounded buffer pool, or straight from a read-only mapping of the file.
+Opening an existing file only reads its meta page, the nodes are loaded on first use.
+Insertions and removals run top-down in a single pass without parent pointers: full nodes are split and minimal
+nodes are refilled on the way down. Changes are durable after flush(), which is crash-safe, the destructor and
+updates that find the buffer pool nearly full of dirty pages flush as well.
+An update that throws halfway, on a failed read or a full buffer pool, may leave its nodes half restructured in the
+pool. Nothing is flushed from then on, neither by flush() nor by the destructor, and further updates are refused:
+reopening the file brings back the state of the last flush.
+Each node entry stores a value together with the number of times it was inserted.
+*/
+template <typename T, size_t PageSize = 4096, size_t t = paged::DegreeFor<T, PageSize>>
+class PagedBTree
+{
+    static constexpr size_t MinDegree = 2;
+    static_assert(t >= MinDegree, "t value must be at least 2");
+    static_assert(std::is_trivially_copyable_v<T>, "PagedBTree stores its values as raw bytes");
+
+    using Node = paged::Node<T, t>;
+    using Pool = BufferPool<PageSize>;
+    using PageGuard = typename Pool::PageGuard;
+    static_assert(sizeof(Node) <= PageSize, "A node of degree t does not fit into a page");
+    static constexpr size_t MaxVals = 2 * t - 1;
+
+    static constexpr uint64_t Magic = 0x31454552'54444750; // "PGDTREE1"
+    struct Meta
+    {
+        uint64_t magic;
+        uint64_t value_size;
+        uint64_t degree;
+        paged::PageId root;
+        uint64_t height;
+        uint64_t size;
+    };
+    static_assert(sizeof(Meta) <= Pool::UserBytes);
+
+    mutable Pool pool;
+    bool interrupted = false; // an update threw before it was done, the cached pages must not reach the file
+
+public:
+    static constexpr size_t Degree = t;
+
+    explicit PagedBTree(const std::string& path, size_t pool_pages = 1024,
+                        paged::OpenMode mode = paged::OpenMode::ReadWrite);
+    ~PagedBTree()
+    {
+        if (this->interrupted)
+        {
+            std::cerr << "WARNING: an update of the paged tree failed halfway, the changes since the last flush are lost\n";
+            return;
+        }
+        try
+        {
+            this->flush();
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << std::format("WARNING: the last changes of the paged tree were not flushed: {}", error.what()) << '\n';
+        }
+    }
+    PagedBTree(PagedBTree&& other) = delete;
+    PagedBTree& operator=(PagedBTree&& other) = delete;
+    PagedBTree(const PagedBTree& other) = delete;
+    PagedBTree& operator=(const PagedBTree& other) = delete;
+
+    void insert(const T& val);
+    void remove(const T& val);
+    size_t count(const T& val)const;
+    size_t size()const
+    {
+        return this->meta().size;
+    }
+    // make every change so far durable, after a crash the file reopens with the state of the last complete flush
+    void flush()
+    {
+        this->requireIntact();
+        this->pool.flush();
+    }
+    // forget the cached pages, in the buffer pool and in the kernel, so the next reads go to the disk
+    void dropCaches()
+    {
+        this->pool.dropCaches();
+    }
+
+private:
+    const Meta& meta()const
+    {
+        return *reinterpret_cast<const Meta*>(this->pool.userArea());
+    }
+    Meta& mutableMeta()
+    {
+        return *reinterpret_cast<Meta*>(this->pool.mutableUserArea());
+    }
+    static size_t lowerBound(const Node* node, const T& val)
+    {
+        return node_search::lowerBound(node->keys.data(), node->count, val);
+    }
+    void requireWritable()const
+    {
+        if (this->pool.isReadOnly())
+            throw std::logic_error("The paged tree is opened read-only");
+        this->requireIntact();
+    }
+    void requireIntact()const
+    {
+        if (this->interrupted)
+            throw std::logic_error("An update of the paged tree failed halfway, reopen the file to get the flushed state");
+    }
+    void flushIfNeeded();
+    void splitChild(PageGuard& parent, size_t index, PageGuard& child);
+    PageGuard refillChild(PageGuard& parent, size_t index, PageGuard child);
+    void rotateRight(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right);
+    void rotateLeft(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right);
+    void mergeChildren(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right);
+    std::pair<T, uint64_t> lastEntry(paged::PageId subtree)const;
+    std::pair<T, uint64_t> firstEntry(paged::PageId subtree)const;
+    static void insertEntry(Node* node, size_t index, const T& val, uint64_t count);
+    static void eraseEntry(Node* node, size_t index);
+};
+
+#include "paged_tree_impl.ipp"
+#endif
@@ -0,0 +1,353 @@
+#ifndef PAGED_TREE_IMPL_TPP
+#define PAGED_TREE_IMPL_TPP
+#include "paged_tree.h"
+
+template <typename T, size_t PageSize, size_t t>
+PagedBTree<T, PageSize, t>::PagedBTree(const std::string& path, size_t pool_pages, paged::OpenMode mode) :
+    pool(path, pool_pages, mode)
+{
+    if (this->meta().magic == 0)
+    {
+        // a new file starts with an empty leaf as the root
+        PageGuard root = this->pool.allocate();
+        root.template asMutable<Node>()->is_leaf = 1;
+        this->mutableMeta() = Meta{ Magic, sizeof(T), t, root.getId(), 1, 0 };
+        return;
+    }
+    const Meta& meta = this->meta();
+    if (meta.magic != Magic || meta.value_size != sizeof(T) || meta.degree != t)
+        throw std::runtime_error(std::format("{} holds no tree of degree {} with {} byte values", path, t, sizeof(T)));
+}
+
+template <typename T, size_t PageSize, size_t t>
+size_t PagedBTree<T, PageSize, t>::count(const T& val)const
+{
+    PageGuard node = this->pool.fetch(this->meta().root);
+    while (true)
+    {
+        const Node* current = node.template as<Node>();
+        size_t index = lowerBound(current, val);
+        if (index < current->count && current->keys[index] == val)
+            return current->counts[index];
+        if (current->is_leaf)
+            return 0;
+        node = this->pool.fetch(current->children[index]);
+    }
+}
+
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::insert(const T& val)
+{
+    this->requireWritable();
+    this->flushIfNeeded();
+    this->interrupted = true;
+
+    PageGuard node = this->pool.fetch(this->meta().root);
+    if (node.template as<Node>()->count == MaxVals)
+    {
+        // the tree grows at the top: a new root gets the full one as its only child and splits it
+        PageGuard new_root = this->pool.allocate();
+        new_root.template asMutable<Node>()->children[0] = node.getId();
+        this->splitChild(new_root, 0, node);
+        Meta& meta = this->mutableMeta();
+        meta.root = new_root.getId();
+        meta.height++;
+        node = std::move(new_root);
+    }
+
+    // every node entered has room, so a split below always finds space for the separator
+    while (true)
+    {
+        const Node* current = node.template as<Node>();
+        size_t index = lowerBound(current, val);
+        if (index < current->count && current->keys[index] == val)
+        {
+            node.template asMutable<Node>()->counts[index]++;
+            break;
+        }
+        if (current->is_leaf)
+        {
+            insertEntry(node.template asMutable<Node>(), index, val, 1);
+            break;
+        }
+        PageGuard child = this->pool.fetch(current->children[index]);
+        if (child.template as<Node>()->count == MaxVals)
+        {
+            this->splitChild(node, index, child);
+            // the middle value of the child moved up in front of it, val may be that one or belong to the new right half
+            if (current->keys[index] == val)
+            {
+                node.template asMutable<Node>()->counts[index]++;
+                break;
+            }
+            if (current->keys[index] < val)
+                child = this->pool.fetch(current->children[index + 1]);
+        }
+        node = std::move(child);
+    }
+    this->mutableMeta().size++;
+    this->interrupted = false;
+}
+
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::remove(const T& val)
+{
+    this->requireWritable();
+    this->flushIfNeeded();
+    this->interrupted = true;
+
+    // a value in an inner node is replaced by its predecessor or successor entry, which is then removed as a whole
+    T key = val;
+    bool whole_entry = false;
+    bool removed = true;
+    PageGuard node = this->pool.fetch(this->meta().root);
+    while (true)
+    {
+        const Node* current = node.template as<Node>();
+        size_t index = lowerBound(current, key);
+        bool found = index < current->count && current->keys[index] == key;
+        if (found && !whole_entry && current->counts[index] > 1)
+        {
+            node.template asMutable<Node>()->counts[index]--;
+            break;
+        }
+        if (found && current->is_leaf)
+        {
+            eraseEntry(node.template asMutable<Node>(), index);
+            break;
+        }
+        if (current->is_leaf && !found)
+        {
+            // a missing value is only known at the leaf, the refills on the way there still keep the tree valid
+            removed = false;
+            break;
+        }
+        if (found)
+        {
+            PageGuard left = this->pool.fetch(current->children[index]);
+            PageGuard right = this->pool.fetch(current->children[index + 1]);
+            if (left.template as<Node>()->count >= t)
+            {
+                auto [predecessor, count] = this->lastEntry(left.getId());
+                Node* mutable_node = node.template asMutable<Node>();
+                mutable_node->keys[index] = predecessor;
+                mutable_node->counts[index] = count;
+                key = predecessor;
+                whole_entry = true;
+                node = std::move(left);
+            }
+            else if (right.template as<Node>()->count >= t)
+            {
+                auto [successor, count] = this->firstEntry(right.getId());
+                Node* mutable_node = node.template asMutable<Node>();
+                mutable_node->keys[index] = successor;
+                mutable_node->counts[index] = count;
+                key = successor;
+                whole_entry = true;
+                node = std::move(right);
+            }
+            else
+            {
+                // both neighbours are minimal, the value sinks into their merge
+                this->mergeChildren(node, index, left, right);
+                node = std::move(left);
+            }
+            continue;
+        }
+
+        // every node entered can lose a value, so a merge below never leaves its parent short
+        PageGuard child = this->pool.fetch(current->children[index]);
+        if (child.template as<Node>()->count < t)
+            child = this->refillChild(node, index, std::move(child));
+        node = std::move(child);
+    }
+    node = PageGuard();
+
+    Meta& meta = this->mutableMeta();
+    meta.size -= removed;
+    PageGuard root = this->pool.fetch(meta.root);
+    const Node* root_node = root.template as<Node>();
+    if (!root_node->is_leaf && root_node->count == 0)
+    {
+        // the last separator of the root went into a merge, its only child becomes the root
+        paged::PageId old_root = root.getId();
+        meta.root = root_node->children[0];
+        meta.height--;
+        root = PageGuard();
+        this->pool.release(old_root);
+    }
+    this->interrupted = false;
+    if (!removed)
+        throw std::runtime_error(std::format("Node with key = {} was not found in the tree", val));
+}
+
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::flushIfNeeded()
+{
+    // an update dirties at most a node, a sibling, a new or freed page per level and the root
+    size_t reserve = 4 * (this->meta().height + 2);
+    if (this->pool.getDirtyCount() + reserve > this->pool.getFrameCount())
+        this->flush();
+}
+
+// move the upper half of the full child into a new right sibling, the middle entry goes up into the parent
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::splitChild(PageGuard& parent, size_t index, PageGuard& child)
+{
+    PageGuard right = this->pool.allocate();
+    Node* parent_node = parent.template asMutable<Node>();
+    Node* left_node = child.template asMutable<Node>();
+    Node* right_node = right.template asMutable<Node>();
+
+    right_node->is_leaf = left_node->is_leaf;
+    right_node->count = t - 1;
+    std::copy(left_node->keys.begin() + t, left_node->keys.begin() + MaxVals, right_node->keys.begin());
+    std::copy(left_node->counts.begin() + t, left_node->counts.begin() + MaxVals, right_node->counts.begin());
+    if (!left_node->is_leaf)
+        std::copy(left_node->children.begin() + t, left_node->children.begin() + MaxVals + 1, right_node->children.begin());
+
+    std::copy_backward(parent_node->children.begin() + index + 1, parent_node->children.begin() + parent_node->count + 1,
+                       parent_node->children.begin() + parent_node->count + 2);
+    parent_node->children[index + 1] = right.getId();
+    insertEntry(parent_node, index, left_node->keys[t - 1], left_node->counts[t - 1]);
+    left_node->count = t - 1;
+}
+
+// give the minimal child at index a value from a sibling, or merge it with one; returns the node now covering it
+template <typename T, size_t PageSize, size_t t>
+typename PagedBTree<T, PageSize, t>::PageGuard PagedBTree<T, PageSize, t>::refillChild(PageGuard& parent, size_t index,
+                                                                                      PageGuard child)
+{
+    const Node* parent_node = parent.template as<Node>();
+    if (index > 0)
+    {
+        PageGuard left = this->pool.fetch(parent_node->children[index - 1]);
+        if (left.template as<Node>()->count >= t)
+        {
+            this->rotateRight(parent, index - 1, left, child);
+            return child;
+        }
+    }
+    if (index < parent_node->count)
+    {
+        PageGuard right = this->pool.fetch(parent_node->children[index + 1]);
+        if (right.template as<Node>()->count >= t)
+            this->rotateLeft(parent, index, child, right);
+        else
+            this->mergeChildren(parent, index, child, right);
+        return child;
+    }
+    PageGuard left = this->pool.fetch(parent_node->children[index - 1]);
+    this->mergeChildren(parent, index - 1, left, child);
+    return left;
+}
+
+// the separator moves down to the front of the right node, the last entry of the left node takes its place
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::rotateRight(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right)
+{
+    Node* parent_node = parent.template asMutable<Node>();
+    Node* left_node = left.template asMutable<Node>();
+    Node* right_node = right.template asMutable<Node>();
+
+    if (!right_node->is_leaf)
+    {
+        std::copy_backward(right_node->children.begin(), right_node->children.begin() + right_node->count + 1,
+                           right_node->children.begin() + right_node->count + 2);
+        right_node->children[0] = left_node->children[left_node->count];
+    }
+    insertEntry(right_node, 0, parent_node->keys[separator], parent_node->counts[separator]);
+    parent_node->keys[separator] = left_node->keys[left_node->count - 1];
+    parent_node->counts[separator] = left_node->counts[left_node->count - 1];
+    left_node->count--;
+}
+
+// the separator moves down to the end of the left node, the first entry of the right node takes its place
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::rotateLeft(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right)
+{
+    Node* parent_node = parent.template asMutable<Node>();
+    Node* left_node = left.template asMutable<Node>();
+    Node* right_node = right.template asMutable<Node>();
+
+    if (!left_node->is_leaf)
+    {
+        left_node->children[left_node->count + 1] = right_node->children[0];
+        std::copy(right_node->children.begin() + 1, right_node->children.begin() + right_node->count + 1,
+                  right_node->children.begin());
+    }
+    insertEntry(left_node, left_node->count, parent_node->keys[separator], parent_node->counts[separator]);
+    parent_node->keys[separator] = right_node->keys[0];
+    parent_node->counts[separator] = right_node->counts[0];
+    eraseEntry(right_node, 0);
+}
+
+// the separator and the whole right node are appended to the left node, the right page is freed
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::mergeChildren(PageGuard& parent, size_t separator, PageGuard& left, PageGuard& right)
+{
+    Node* parent_node = parent.template asMutable<Node>();
+    Node* left_node = left.template asMutable<Node>();
+    const Node* right_node = right.template as<Node>();
+
+    size_t left_count = left_node->count;
+    insertEntry(left_node, left_count, parent_node->keys[separator], parent_node->counts[separator]);
+    std::copy(right_node->keys.begin(), right_node->keys.begin() + right_node->count, left_node->keys.begin() + left_count + 1);
+    std::copy(right_node->counts.begin(), right_node->counts.begin() + right_node->count,
+              left_node->counts.begin() + left_count + 1);
+    if (!left_node->is_leaf)
+        std::copy(right_node->children.begin(), right_node->children.begin() + right_node->count + 1,
+                  left_node->children.begin() + left_count + 1);
+    left_node->count += right_node->count;
+
+    eraseEntry(parent_node, separator);
+    std::copy(parent_node->children.begin() + separator + 2, parent_node->children.begin() + parent_node->count + 2,
+              parent_node->children.begin() + separator + 1);
+
+    paged::PageId freed = right.getId();
+    right = PageGuard();
+    this->pool.release(freed);
+}
+
+template <typename T, size_t PageSize, size_t t>
+std::pair<T, uint64_t> PagedBTree<T, PageSize, t>::lastEntry(paged::PageId subtree)const
+{
+    PageGuard node = this->pool.fetch(subtree);
+    while (!node.template as<Node>()->is_leaf)
+    {
+        const Node* current = node.template as<Node>();
+        node = this->pool.fetch(current->children[current->count]);
+    }
+    const Node* leaf = node.template as<Node>();
+    return { leaf->keys[leaf->count - 1], leaf->counts[leaf->count - 1] };
+}
+
+template <typename T, size_t PageSize, size_t t>
+std::pair<T, uint64_t> PagedBTree<T, PageSize, t>::firstEntry(paged::PageId subtree)const
+{
+    PageGuard node = this->pool.fetch(subtree);
+    while (!node.template as<Node>()->is_leaf)
+        node = this->pool.fetch(node.template as<Node>()->children[0]);
+    const Node* leaf = node.template as<Node>();
+    return { leaf->keys[0], leaf->counts[0] };
+}
+
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::insertEntry(Node* node, size_t index, const T& val, uint64_t count)
+{
+    std::copy_backward(node->keys.begin() + index, node->keys.begin() + node->count, node->keys.begin() + node->count + 1);
+    std::copy_backward(node->counts.begin() + index, node->counts.begin() + node->count,
+                       node->counts.begin() + node->count + 1);
+    node->keys[index] = val;
+    node->counts[index] = count;
+    node->count++;
+}
+
+template <typename T, size_t PageSize, size_t t>
+void PagedBTree<T, PageSize, t>::eraseEntry(Node* node, size_t index)
+{
+    std::copy(node->keys.begin() + index + 1, node->keys.begin() + node->count, node->keys.begin() + index);
+    std::copy(node->counts.begin() + index + 1, node->counts.begin() + node->count, node->counts.begin() + index);
+    node->count--;
+}
+#endif
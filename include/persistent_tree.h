@@ -0,0 +1,203 @@
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "node_search.h"
+#include "top_down_node.h"
+
+
+/*
+B-tree with O(1) snapshots. Nodes are shared between versions through std::shared_ptr and never change once
+another version can see them: an update copies the nodes on its path that are shared and changes only the copies,
+a node owned by the current version alone is changed in place. snapshot() hands out the current root, so a reader
+keeps a consistent view for as long as it holds the snapshot, and the nodes of a version no other one shares are
+freed when its last snapshot is dropped.
+The tree has a single writer: insert, remove and snapshot are called from one thread at a time. Snapshots are
+immutable, any thread can read, copy and drop them without synchronizing with the writer or each other.
+Insertions and removals run top-down in a single pass as in BTree with Restructuring::TopDown, so each level is
+copied at most once per update. The nodes are TopDownNodes with shared children, the payload of an entry is the
+number of copies of its value.
+*/
+template <typename T, size_t t>
+class PersistentBTree
+{
+    static constexpr size_t MinDegree = 2;
+    static_assert(t >= MinDegree, "t value must be at least 2");
+    static_assert(std::is_copy_constructible_v<T> && std::is_copy_assignable_v<T>,
+                  "PersistentBTree copies the values of shared nodes");
+
+    using Node = TopDownNode<T, size_t, t, Sharing::Shared>;
+    static constexpr size_t MaxVals = Node::MaxKeys;
+
+    std::shared_ptr<Node> root;
+    size_t values_count;
+
+public:
+    class Iterator;
+    class Snapshot;
+
+    PersistentBTree() : root(std::make_shared<Node>(true)), values_count(0) {}
+    ~PersistentBTree() = default;
+    PersistentBTree(PersistentBTree&& other) = delete;
+    PersistentBTree& operator=(PersistentBTree&& other) = delete;
+    PersistentBTree(const PersistentBTree& other) = delete;
+    PersistentBTree& operator=(const PersistentBTree& other) = delete;
+
+    void insert(const T& val);
+    void remove(const T& val);
+    size_t count(const T& val)const
+    {
+        return countIn(this->root.get(), val);
+    }
+    size_t size()const
+    {
+        return this->values_count;
+    }
+    // the current version, unaffected by later updates
+    Snapshot snapshot()const
+    {
+        return Snapshot(this->root, this->values_count);
+    }
+
+private:
+    static size_t lowerBound(const Node* node, const T& val)
+    {
+        return node_search::lowerBound(node->keys.data(), node->count, val);
+    }
+    static size_t countIn(const Node* node, const T& val);
+};
+
+/*
+Forward iterator over the values of a snapshot in ascending order, a value with a duplicate count of k is visited
+k times. Nodes keep no parent pointers since a node can belong to several versions, the iterator keeps the path
+from the root instead.
+*/
+template <typename T, size_t t>
+class PersistentBTree<T, t>::Iterator
+{
+public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+private:
+    friend class PersistentBTree<T, t>::Snapshot;
+
+    // the index of the inner nodes on the path is the entry that follows the subtree being visited
+    std::vector<std::pair<const Node*, size_t>> path;
+    size_t copy; // which of the duplicates of the current value is visited
+
+    explicit Iterator(const Node* root) : path(), copy(0)
+    {
+        if (root)
+        {
+            this->descendLeftmost(root);
+            this->skipFinished();
+        }
+    }
+    void descendLeftmost(const Node* node)
+    {
+        this->path.emplace_back(node, 0);
+        while (!node->is_leaf)
+        {
+            node = node->children[0].get();
+            this->path.emplace_back(node, 0);
+        }
+    }
+    // leave the nodes whose entries are all visited, the path ends empty past the last value
+    void skipFinished()
+    {
+        while (!this->path.empty() && this->path.back().second >= this->path.back().first->count)
+            this->path.pop_back();
+    }
+
+public:
+    Iterator() : path(), copy(0) {}
+
+    reference operator*()const
+    {
+        return this->path.back().first->keys[this->path.back().second];
+    }
+    pointer operator->()const
+    {
+        return &**this;
+    }
+    Iterator& operator++()
+    {
+        auto& [node, index] = this->path.back();
+        if (++this->copy < node->payloads[index])
+            return *this;
+        this->copy = 0;
+        index++;
+        if (!node->is_leaf)
+            this->descendLeftmost(node->children[index].get());
+        this->skipFinished();
+        return *this;
+    }
+    Iterator operator++(int)
+    {
+        Iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+    friend bool operator==(const Iterator& left, const Iterator& right)
+    {
+        if (left.path.empty() || right.path.empty())
+            return left.path.empty() == right.path.empty();
+        return left.path.back() == right.path.back() && left.copy == right.copy;
+    }
+};
+
+// an immutable version of the tree, cheap to copy and safe to read from any thread
+template <typename T, size_t t>
+class PersistentBTree<T, t>::Snapshot
+{
+    friend class PersistentBTree<T, t>;
+
+    std::shared_ptr<const Node> root;
+    size_t values_count;
+
+    Snapshot(std::shared_ptr<const Node> root, size_t values_count) : root(std::move(root)), values_count(values_count) {}
+
+public:
+    Snapshot() : root(), values_count(0) {}
+
+    size_t count(const T& val)const
+    {
+        return this->root ? countIn(this->root.get(), val) : 0;
+    }
+    bool contains(const T& val)const
+    {
+        return this->count(val) > 0;
+    }
+    size_t size()const
+    {
+        return this->values_count;
+    }
+    bool empty()const
+    {
+        return this->values_count == 0;
+    }
+    Iterator begin()const
+    {
+        return Iterator(this->root.get());
+    }
+    Iterator end()const
+    {
+        return Iterator();
+    }
+};
+
+#include "persistent_tree_impl.ipp"
+#endif
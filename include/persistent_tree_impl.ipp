@@ -0,0 +1,121 @@
+#ifndef PERSISTENT_TREE_IMPL_TPP
+#define PERSISTENT_TREE_IMPL_TPP
+#include "persistent_tree.h"
+
+template <typename T, size_t t>
+size_t PersistentBTree<T, t>::countIn(const Node* node, const T& val)
+{
+    while (true)
+    {
+        size_t index = lowerBound(node, val);
+        if (index < node->count && node->keys[index] == val)
+            return node->payloads[index];
+        if (node->is_leaf)
+            return 0;
+        node = node->children[index].get();
+    }
+}
+
+template <typename T, size_t t>
+void PersistentBTree<T, t>::insert(const T& val)
+{
+    // the path is copied where it is shared one node ahead of the descent, so older versions never see a change;
+    // a root with no room left moves under a new root and is halved, every later node entered has a free slot too
+    Node::own(this->root);
+    if (this->root->count == MaxVals)
+    {
+        auto new_root = std::make_shared<Node>(false);
+        new_root->children[0] = std::move(this->root);
+        this->root = std::move(new_root);
+        this->root->splitChild(0, std::make_shared<Node>(this->root->children[0]->is_leaf));
+    }
+
+    Node* node = this->root.get();
+    while (true)
+    {
+        size_t index = lowerBound(node, val);
+        if (index < node->count && node->keys[index] == val)
+        {
+            node->payloads[index]++;
+            break;
+        }
+        if (node->is_leaf)
+        {
+            node->insertEntry(index, val, size_t{ 1 });
+            break;
+        }
+        Node::own(node->children[index]);
+        if (node->children[index]->count == MaxVals)
+        {
+            // the median of the child moved up to index, val may be equal to it or belong to either half
+            node->splitChild(index, std::make_shared<Node>(node->children[index]->is_leaf));
+            continue;
+        }
+        node = node->children[index].get();
+    }
+    this->values_count++;
+}
+
+template <typename T, size_t t>
+void PersistentBTree<T, t>::remove(const T& val)
+{
+    /*
+    The descent copies the shared nodes it enters and tops up every child it is about to enter to t values, so the
+    leaf at the end can give one up. A val found in an inner node stays put while the descent runs down the right
+    edge of its left subtree, and the last entry of the leaf there is then moved up over it.
+    Reaching a leaf without val means it is missing, the path copied and topped up on the way is a valid tree still.
+    */
+    Node::own(this->root);
+    Node* node = this->root.get();
+    Node* holder = nullptr; // the inner node holding val, once the predecessor is sought
+    size_t holder_index = 0;
+    while (true)
+    {
+        size_t index = node->count;
+        bool found = false;
+        if (!holder)
+        {
+            index = lowerBound(node, val);
+            found = index < node->count && node->keys[index] == val;
+            if (found && (node->payloads[index] > 1 || node->is_leaf))
+            {
+                if (node->payloads[index] > 1)
+                    node->payloads[index]--;
+                else
+                    node->eraseEntry(index);
+                break;
+            }
+            if (!found && node->is_leaf)
+                throw std::runtime_error(std::format("Node with key = {} was not found in the tree", val));
+        }
+        else if (node->is_leaf)
+        {
+            holder->keys[holder_index] = std::move(node->keys[node->count - 1]);
+            holder->payloads[holder_index] = node->payloads[node->count - 1];
+            node->eraseEntry(node->count - 1);
+            break;
+        }
+
+        Node::own(node->children[index]);
+        if (node->children[index]->count < t)
+        {
+            node->refillChild(index); // a merged right node is dropped here, or kept alive by the versions sharing it
+            if (node->count == 0)
+            {
+                // only the root can run out of entries, its single remaining child takes over as the root
+                this->root = std::move(node->children[0]);
+                node = this->root.get();
+            }
+            continue; // val or the child may have moved to a sibling, the same node is looked at again
+        }
+        if (found)
+        {
+            holder = node;
+            holder_index = index;
+        }
+        node = node->children[index].get();
+    }
+    this->values_count--;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TOP_DOWN_NODE_H
+#define TOP_DOWN_NODE_H
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "node_search.h"
+
+
+// how a TopDownNode holds its children
+enum class Sharing
+{
+    Exclusive, // raw pointers, every node belongs to a single tree
+    Shared     // std::shared_ptr, a node can belong to several versions and is copied before it changes
+};
+
+/*
+Node of the trees that restructure top-down without parent pointers, BTreeMap and PersistentBTree.
+An entry is a key and a payload kept in parallel arrays: the mapped value in a map, the duplicate count in a
+persistent tree. Nodes hold t - 1 to 2t - 1 entries, the root down to none.
+The restructuring steps are called on the parent on the way down and change its children, the tree searches,
+allocates and frees the nodes. This node and the child at the index passed must already be writable; with
+Sharing::Shared the steps call own() on a sibling before changing it and copy out of a right sibling they merge.
+*/
+template <typename Key, typename Payload, size_t t, Sharing Links>
+struct TopDownNode
+{
+    using Child = std::conditional_t<Links == Sharing::Shared, std::shared_ptr<TopDownNode>, TopDownNode*>;
+    static constexpr size_t MaxKeys = 2 * t - 1;
+
+    bool is_leaf;
+    size_t count;
+    alignas(CacheLineSize) std::array<Key, node_search::PaddedCapacity<Key, MaxKeys>> keys;
+    std::array<Payload, MaxKeys> payloads;
+    std::array<Child, MaxKeys + 1> children;
+
+    explicit TopDownNode(bool is_leaf) : is_leaf(is_leaf), count(0), keys(), payloads(), children() {}
+
+    // make the node in the slot one only this version sees, copying it if another version holds it too
+    static void own([[maybe_unused]] Child& slot)
+    {
+        if constexpr (Links == Sharing::Shared)
+        {
+            if (slot.use_count() == 1)
+            {
+                // the count is read relaxed, the fence orders the reads of a version dropped on another thread
+                // before the writes that follow here
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return;
+            }
+            slot = std::make_shared<TopDownNode>(*slot);
+        }
+    }
+
+    // shift the entries from index on one slot to the right and put the entry into the gap
+    template <typename KeyArg, typename PayloadArg>
+    void insertEntry(size_t index, KeyArg&& key, PayloadArg&& payload)
+    {
+        std::move_backward(this->keys.begin() + index, this->keys.begin() + this->count,
+                           this->keys.begin() + this->count + 1);
+        std::move_backward(this->payloads.begin() + index, this->payloads.begin() + this->count,
+                           this->payloads.begin() + this->count + 1);
+        this->keys[index] = std::forward<KeyArg>(key);
+        this->payloads[index] = std::forward<PayloadArg>(payload);
+        this->count++;
+    }
+    // shift the entries after index one slot to the left, the freed last slot lets go of what it still owns
+    void eraseEntry(size_t index)
+    {
+        std::move(this->keys.begin() + index + 1, this->keys.begin() + this->count, this->keys.begin() + index);
+        std::move(this->payloads.begin() + index + 1, this->payloads.begin() + this->count,
+                  this->payloads.begin() + index);
+        this->count--;
+        this->keys[this->count] = Key();
+        this->payloads[this->count] = Payload();
+    }
+
+    // right is a new empty node with the same is_leaf as the full child at index, it takes the upper half
+    void splitChild(size_t index, Child right);
+    // bring the child at index from t - 1 entries up to t; after a merge returns the unlinked right node of the pair
+    Child refillChild(size_t index);
+
+private:
+    void rotateRight(size_t separator);
+    void rotateLeft(size_t separator);
+    Child mergeChildren(size_t separator);
+};
+
+#include "top_down_node_impl.ipp"
+#endif
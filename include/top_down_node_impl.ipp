@@ -0,0 +1,105 @@
+#ifndef TOP_DOWN_NODE_IMPL_TPP
+#define TOP_DOWN_NODE_IMPL_TPP
+#include "top_down_node.h"
+
+template <typename Key, typename Payload, size_t t, Sharing Links>
+void TopDownNode<Key, Payload, t, Links>::splitChild(size_t index, Child right)
+{
+    // the child keeps its first t - 1 entries, entry t - 1 becomes the separator in front of the new sibling
+    TopDownNode* child = &*this->children[index];
+    std::move(child->keys.begin() + t, child->keys.begin() + MaxKeys, right->keys.begin());
+    std::move(child->payloads.begin() + t, child->payloads.begin() + MaxKeys, right->payloads.begin());
+    if (!child->is_leaf)
+        std::move(child->children.begin() + t, child->children.begin() + MaxKeys + 1, right->children.begin());
+    right->count = t - 1;
+    child->count = t - 1;
+
+    std::move_backward(this->children.begin() + index + 1, this->children.begin() + this->count + 1,
+                       this->children.begin() + this->count + 2);
+    this->children[index + 1] = std::move(right);
+    this->insertEntry(index, std::move(child->keys[t - 1]), std::move(child->payloads[t - 1]));
+}
+
+template <typename Key, typename Payload, size_t t, Sharing Links>
+typename TopDownNode<Key, Payload, t, Links>::Child TopDownNode<Key, Payload, t, Links>::refillChild(size_t index)
+{
+    // a sibling with an entry to spare lends it through the separator, the left one first
+    if (index > 0 && this->children[index - 1]->count >= t)
+        this->rotateRight(index - 1);
+    else if (index < this->count && this->children[index + 1]->count >= t)
+        this->rotateLeft(index);
+    else
+        return this->mergeChildren(index < this->count ? index : index - 1);
+    return Child();
+}
+
+// the separator goes down in front of the right child, the last entry of the left child takes its slot
+template <typename Key, typename Payload, size_t t, Sharing Links>
+void TopDownNode<Key, Payload, t, Links>::rotateRight(size_t separator)
+{
+    own(this->children[separator]);
+    TopDownNode* left = &*this->children[separator];
+    TopDownNode* right = &*this->children[separator + 1];
+    if (!right->is_leaf)
+    {
+        std::move_backward(right->children.begin(), right->children.begin() + right->count + 1,
+                           right->children.begin() + right->count + 2);
+        right->children[0] = std::move(left->children[left->count]);
+    }
+    right->insertEntry(0, std::move(this->keys[separator]), std::move(this->payloads[separator]));
+    this->keys[separator] = std::move(left->keys[left->count - 1]);
+    this->payloads[separator] = std::move(left->payloads[left->count - 1]);
+    left->count--;
+}
+
+// the separator goes down behind the left child, the first entry of the right child takes its slot
+template <typename Key, typename Payload, size_t t, Sharing Links>
+void TopDownNode<Key, Payload, t, Links>::rotateLeft(size_t separator)
+{
+    own(this->children[separator + 1]);
+    TopDownNode* left = &*this->children[separator];
+    TopDownNode* right = &*this->children[separator + 1];
+    left->insertEntry(left->count, std::move(this->keys[separator]), std::move(this->payloads[separator]));
+    if (!left->is_leaf)
+    {
+        left->children[left->count] = std::move(right->children[0]);
+        std::move(right->children.begin() + 1, right->children.begin() + right->count + 1, right->children.begin());
+        right->children[right->count] = Child();
+    }
+    this->keys[separator] = std::move(right->keys[0]);
+    this->payloads[separator] = std::move(right->payloads[0]);
+    right->eraseEntry(0);
+}
+
+// the left child takes the separator and all of the right child, which is unlinked and handed back
+template <typename Key, typename Payload, size_t t, Sharing Links>
+typename TopDownNode<Key, Payload, t, Links>::Child TopDownNode<Key, Payload, t, Links>::mergeChildren(size_t separator)
+{
+    own(this->children[separator]);
+    TopDownNode* left = &*this->children[separator];
+    Child right = std::move(this->children[separator + 1]);
+    left->insertEntry(left->count, std::move(this->keys[separator]), std::move(this->payloads[separator]));
+
+    // a shared right node may still be part of another version, so its contents are copied rather than moved
+    auto transfer = [](auto first, auto last, auto destination)
+    {
+        if constexpr (Links == Sharing::Shared)
+            std::copy(first, last, destination);
+        else
+            std::move(first, last, destination);
+    };
+    transfer(right->keys.begin(), right->keys.begin() + right->count, left->keys.begin() + left->count);
+    transfer(right->payloads.begin(), right->payloads.begin() + right->count, left->payloads.begin() + left->count);
+    if (!left->is_leaf)
+        transfer(right->children.begin(), right->children.begin() + right->count + 1,
+                 left->children.begin() + left->count);
+    left->count += right->count;
+
+    std::move(this->children.begin() + separator + 2, this->children.begin() + this->count + 1,
+              this->children.begin() + separator + 1);
+    this->children[this->count] = Child();
+    this->eraseEntry(separator);
+    return right;
+}
+
+#endif
@@ -1,55 +1,181 @@
 #ifndef TREE_H
 #define TREE_H
 #include "node.h"
+#include "tree_iterator.h"
+#include <array>
 #include <format>
+#include <ranges>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <vector>
 
-template <typename T>
+/*
+With OrderStatistics = true every node keeps the number of values in its subtree, which makes rank, select,
+countRange and size logarithmic at the price of updating the ancestors on every insertion and removal.
+Strategy picks when nodes are split and refilled. BottomUp changes the node first and then repairs it and its
+ancestors through the parent pointers, nodes keep at most 2t - 2 values. TopDown splits every full node and refills
+every minimal node on the way down, so insert and remove visit each level once and never climb back up,
+nodes keep at most 2t - 1 values. Both keep the parent pointers the iterators use up to date.
+Built with BTREE_ENABLE_STATS the tree also counts its operations, the nodes they visit and its restructuring
+steps, see stats().
+*/
+template <typename T, size_t t, bool OrderStatistics = false, Restructuring Strategy = Restructuring::BottomUp>
 class BTree
 {
-    size_t t;
-    std::shared_ptr<BTreeNode<T>> root;
-    static constexpr int MinDegree = 2;
+    static constexpr size_t MinDegree = 2;
+    static_assert(t >= MinDegree, "t value must be at least 2");
+
+    typename BTreeNode<T, t, OrderStatistics>::Pool pool;
+    BTreeNode<T, t, OrderStatistics>* root;
+    struct OperationTally
+    {
+        std::array<OperationCounts, 3> kinds; // indexed by OperationKind
+        OperationKind current;                // the kind of the call whose visits are being counted
+    };
+    struct NoOperationTally {};
+    // updated by the const lookups too
+    [[no_unique_address]] mutable std::conditional_t<StatsEnabled, OperationTally, NoOperationTally> operation_counts;
 
 public:
-    ~BTree() = default;
+    using iterator = BTreeIterator<T, t, OrderStatistics>;
+    using const_iterator = BTreeIterator<T, t, OrderStatistics>; // values can not be modified in place, they define the order
+
+    ~BTree() 
+    {
+        this->destroySubtree(this->root);
+    }
     BTree(BTree&& other) = delete;
     BTree& operator=(BTree&& other) = delete;
     BTree(const BTree& other) = delete;
     BTree& operator=(const BTree& other) = delete;
-    explicit BTree(size_t t) : t(t), root(std::make_shared<BTreeNode<T>>(t)) 
+    BTree() : pool(), root(nullptr), operation_counts()
     {
-        if (t < MinDegree)
-            throw std::length_error(std::format("t value must be at least {}", MinDegree));
+        this->root = this->pool.create(&this->pool);
     }
-    std::pair<std::shared_ptr<BTreeNode<T>>, size_t> find(const T& val)const;
+    template <typename InputIt>
+    BTree(InputIt first, InputIt last, double fill_factor = 1.0, size_t threads = 1) : BTree()
+    {
+        this->bulkLoad(first, last, fill_factor, threads);
+    }
+    std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> find(const T& val)const;
     void remove(const T &val);
     void insert(const T& val);
-    friend std::ostream& operator<<(std::ostream& o, const BTree<T>& t) 
+    /*
+    Batched operations for values arriving in groups, the results come back in the order of the batch.
+    The batch is sorted first, so neighbouring values share most of their path, and walked in groups of
+    BatchGroupSize descents interleaved level by level: every descent prefetches the node it goes to next while
+    the others search theirs, so the cache misses of a group overlap instead of following each other.
+    The updates only use such a walk to warm the paths of a group, then apply its values one by one, each with a
+    descent of its own: an earlier update of the group may split or merge the nodes the walk found.
+    */
+    std::vector<std::pair<BTreeNode<T, t, OrderStatistics>*, size_t>> findBatch(std::span<const T> vals)const;
+    void insertBatch(std::span<const T> vals);
+    // removes one copy of every value of the batch, the flags tell which values were found
+    std::vector<bool> removeBatch(std::span<const T> vals);
+    /*
+    Replace the contents of the tree with a sorted range, building the nodes bottom-up in O(n).
+    Repeated values are folded into one entry with the matching duplicate count.
+    fill_factor in (0, 1] is the share of the 2t - 2 value slots filled in every node, t - 1 values being the floor,
+    with threads > 1 the nodes of large levels are filled concurrently.
+    */
+    template <typename InputIt>
+    void bulkLoad(InputIt first, InputIt last, double fill_factor = 1.0, size_t threads = 1);
+
+    // ordered traversal, every value is visited as many times as it was inserted
+    iterator begin()const;
+    iterator end()const;
+    iterator lower_bound(const T& val)const;
+    iterator upper_bound(const T& val)const;
+    std::pair<iterator, iterator> equal_range(const T& val)const;
+    // all the values in [lo, hi], both bounds included
+    std::ranges::subrange<iterator> range(const T& lo, const T& hi)const;
+    size_t count(const T& val)const;
+
+    // order statistics, duplicates included
+    size_t size()const requires OrderStatistics
     {
-        t.printBTree(t.root, o);
+        return this->root->getSubtreeSize();
+    }
+    // number of values less than val
+    size_t rank(const T& val)const requires OrderStatistics;
+    // the value with k smaller values before it, end() if the tree holds no more than k values
+    iterator select(size_t k)const requires OrderStatistics;
+    // number of values in [lo, hi], both bounds included
+    size_t countRange(const T& lo, const T& hi)const requires OrderStatistics;
+    // walks the whole tree and throws std::logic_error at the first broken structural invariant, meant for tests
+    void checkInvariants()const;
+    /*
+    Instrumentation, with BTREE_ENABLE_STATS only. The calls and the nodes they visit are counted apart for find,
+    insert and remove since the last resetStats(), count runs through find and every value of a batched insertion or
+    removal counts as one update with its own descent, while the group walks and findBatch are not counted.
+    Nodes, height and fill factor come from a walk over the whole tree.
+    */
+    TreeStats stats()const requires StatsEnabled;
+    void resetStats() requires StatsEnabled;
+    friend std::ostream& operator<<(std::ostream& o, const BTree<T, t, OrderStatistics, Strategy>& tree) 
+    {
+        tree.printBTree(tree.root, o);
         return o;
     }
     
 private:
-    std::pair<std::shared_ptr<BTreeNode<T>>, size_t> findPredecessor(const std::shared_ptr<BTreeNode<T>>& node, size_t index) const 
+    std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> findPredecessor(const BTreeNode<T, t, OrderStatistics>* node, size_t index) const 
     {
-        std::shared_ptr<BTreeNode<T>> predecessor = node->getChildAtIndex(index);
+        BTreeNode<T, t, OrderStatistics>* predecessor = node->getChildAtIndex(index);
+        this->countVisit();
         while (!predecessor->isLeaf())
+        {
             predecessor = predecessor->getChildAtIndex(predecessor->getChildrenCount() - 1);
+            this->countVisit();
+        }
 
         return { predecessor, predecessor->getValsCount() };
     }
-    std::pair<std::shared_ptr<BTreeNode<T>>, size_t> findSuccessor(const std::shared_ptr<BTreeNode<T>>& node, size_t index) const 
+    std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> findSuccessor(const BTreeNode<T, t, OrderStatistics>* node, size_t index) const 
     {
-        std::shared_ptr<BTreeNode<T>> node_ptr = node.lock();
-        std::shared_ptr<BTreeNode<T>> successor = node_ptr->getChildren()[index + 1];
+        BTreeNode<T, t, OrderStatistics>* successor = node->getChildAtIndex(index + 1);
         while (!successor->isLeaf())
-            successor = successor->getChildren().front();
+            successor = successor->getChildAtIndex(0);
 
         return { successor, 0 };
     }
-    void printBTree(std::shared_ptr<BTreeNode<T>> node, std::ostream& o, const std::string& prefix = "", bool is_last = true) const;
+    // a call of the kind starts, the visits up to the next one are charged to it
+    void countOperation([[maybe_unused]] OperationKind kind)const
+    {
+        if constexpr (StatsEnabled)
+        {
+            this->operation_counts.current = kind;
+            this->operation_counts.kinds[static_cast<size_t>(kind)].calls++;
+        }
+    }
+    void countVisit()const
+    {
+        if constexpr (StatsEnabled)
+            this->operation_counts.kinds[static_cast<size_t>(this->operation_counts.current)].nodes_visited++;
+    }
+    std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> locate(const T& val)const;
+    static constexpr size_t BatchGroupSize = 16;
+    std::vector<size_t> sortedOrder(std::span<const T> vals)const;
+    template <typename Visit>
+    void descendGroup(std::span<const T> vals, std::span<const size_t> group, Visit visit)const;
+    void removeAt(BTreeNode<T, t, OrderStatistics>* node, size_t index);
+    void insertTopDown(const T& val);
+    // both return false when val is not in the tree
+    bool removeOne(const T& val);
+    bool removeTopDown(const T& val);
+    size_t countBelow(const T& val, bool inclusive)const requires OrderStatistics;
+    static size_t nodesForLevel(size_t vals_count, double fill_factor);
+    std::vector<BTreeNode<T, t, OrderStatistics>*> buildLevel(std::vector<T>& vals, std::vector<size_t>& counts,
+                                             const std::vector<BTreeNode<T, t, OrderStatistics>*>& children,
+                                             double fill_factor, size_t threads);
+    void destroySubtree(BTreeNode<T, t, OrderStatistics>* node)
+    {
+        for (size_t i = 0; i < node->getChildrenCount(); ++i)
+            this->destroySubtree(node->getChildAtIndex(i));
+        this->pool.destroy(node);
+    }
+    void printBTree(const BTreeNode<T, t, OrderStatistics>* node, std::ostream& o, const std::string& prefix = "", bool is_last = true) const;
 };
 
 #include "tree_impl.ipp"
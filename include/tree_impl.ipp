@@ -1,13 +1,25 @@
 #ifndef TREE_IMPL_TPP
 #define TREE_IMPL_TPP
+#include <algorithm>
+#include <array>
 #include <format>
+#include <iterator>
+#include <numeric>
+#include <thread>
 
-template <typename T>
-std::pair<std::shared_ptr<BTreeNode<T>>, size_t> BTree<T>::find(const T& val)const
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> BTree<T, t, OrderStatistics, Strategy>::find(const T& val)const
 {
-    std::shared_ptr<BTreeNode<T>> node = root;
+    this->countOperation(OperationKind::Find);
+    return this->locate(val);
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::pair<BTreeNode<T, t, OrderStatistics>*, size_t> BTree<T, t, OrderStatistics, Strategy>::locate(const T& val)const
+{
+    BTreeNode<T, t, OrderStatistics>* node = root;
     while (node)
     {
+        this->countVisit();
         size_t index = node->findLowerBoundIndexOfVal(val);
         bool lower_bound_in_node = index != node->getValsCount();
         if (lower_bound_in_node && node->getValAtIndex(index) == val)
@@ -20,14 +32,19 @@ std::pair<std::shared_ptr<BTreeNode<T>>, size_t> BTree<T>::find(const T& val)con
     return std::make_pair(nullptr, 0);
     
 }
-template <typename T>
-void BTree<T>::insert(const T& val)
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::insert(const T& val)
 {
     /*
     Try to insert a value val into the leaf node
-    Warning is output, when attempting to insert a value that is already in the tree
+    A value that is already in the tree only gets its duplicate count increased
     */
-    std::shared_ptr<BTreeNode<T>> node = root;
+    this->countOperation(OperationKind::Insert);
+    if constexpr (Strategy == Restructuring::TopDown)
+        return this->insertTopDown(val);
+
+    BTreeNode<T, t, OrderStatistics>* node = root;
+    this->countVisit();
     while (!node->isLeaf())
     {
         size_t index = node->findLowerBoundIndexOfVal(val);
@@ -40,28 +57,530 @@ void BTree<T>::insert(const T& val)
             node = node->getChildAtIndex(index);
         else
             node = node->getChildAtIndex(node->getChildrenCount() - 1);
-       
+        this->countVisit();
     }
     node->insertVal(val);
 }
-template<typename T>
-void BTree<T>::remove(const T &val){
-    auto [node, index] = this->find(val);
-    if (!node)
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::remove(const T &val){
+    this->countOperation(OperationKind::Remove);
+    if (!this->removeOne(val))
         throw std::runtime_error(std::format("Node with key = {} was not found in the tree", val));
-    
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+bool BTree<T, t, OrderStatistics, Strategy>::removeOne(const T& val)
+{
+    if constexpr (Strategy == Restructuring::TopDown)
+        return this->removeTopDown(val);
+
+    auto [node, index] = this->locate(val);
+    if (!node)
+        return false;
+    this->removeAt(node, index);
+    return true;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::removeAt(BTreeNode<T, t, OrderStatistics>* node, size_t index)
+{
+    if (node->getEntryCount(index) > 1)
+    {
+        // only one of the duplicates goes away, the entry itself stays where it is
+        node->removeValueByIndex(index);
+        return;
+    }
     if (!node->isLeaf()){
         auto [predecessor, _] = findPredecessor(node, index);
         node->swapWithPredecessor(predecessor, index);
         node = predecessor;
-        index = node->findIndexOfVal(val);
+        index = node->getValsCount() - 1; // the swap left the value at the end of the leaf
     }
     
     node->removeValueByIndex(index);
 }
 
-template<typename T>
-void BTree<T>::printBTree(std::shared_ptr<BTreeNode<T>> node, std::ostream &o, const std::string& prefix, bool is_last) const{
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::vector<std::pair<BTreeNode<T, t, OrderStatistics>*, size_t>> BTree<T, t, OrderStatistics, Strategy>::findBatch(std::span<const T> vals)const
+{
+    std::vector<std::pair<BTreeNode<T, t, OrderStatistics>*, size_t>> results(vals.size(), { nullptr, 0 });
+    std::vector<size_t> order = this->sortedOrder(vals);
+    for (size_t first = 0; first < order.size(); first += BatchGroupSize)
+    {
+        std::span<const size_t> group(order.data() + first, std::min(BatchGroupSize, order.size() - first));
+        this->descendGroup(vals, group, [&](size_t position, BTreeNode<T, t, OrderStatistics>* node, size_t index)
+        {
+            results[position] = { node, index };
+        });
+    }
+    return results;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::insertBatch(std::span<const T> vals)
+{
+    std::vector<size_t> order = this->sortedOrder(vals);
+    for (size_t first = 0; first < order.size(); first += BatchGroupSize)
+    {
+        std::span<const size_t> group(order.data() + first, std::min(BatchGroupSize, order.size() - first));
+        this->descendGroup(vals, group, [](size_t, BTreeNode<T, t, OrderStatistics>*, size_t) {});
+        for (size_t position : group)
+            this->insert(vals[position]);
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::vector<bool> BTree<T, t, OrderStatistics, Strategy>::removeBatch(std::span<const T> vals)
+{
+    std::vector<bool> removed(vals.size(), false);
+    std::vector<size_t> order = this->sortedOrder(vals);
+    for (size_t first = 0; first < order.size(); first += BatchGroupSize)
+    {
+        std::span<const size_t> group(order.data() + first, std::min(BatchGroupSize, order.size() - first));
+        this->descendGroup(vals, group, [](size_t, BTreeNode<T, t, OrderStatistics>*, size_t) {});
+        for (size_t position : group)
+        {
+            // the removals before this one may have moved the value, so it is looked up again
+            this->countOperation(OperationKind::Remove);
+            removed[position] = this->removeOne(vals[position]);
+        }
+    }
+    return removed;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::vector<size_t> BTree<T, t, OrderStatistics, Strategy>::sortedOrder(std::span<const T> vals)const
+{
+    std::vector<size_t> order(vals.size());
+    std::iota(order.begin(), order.end(), size_t{ 0 });
+    std::sort(order.begin(), order.end(), [&](size_t left, size_t right) { return vals[left] < vals[right]; });
+    return order;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+template <typename Visit>
+void BTree<T, t, OrderStatistics, Strategy>::descendGroup(std::span<const T> vals, std::span<const size_t> group, Visit visit)const
+{
+    /*
+    Every descent alternates between two steps, one per round over the group: searching its node, which ends with
+    a prefetch of the child slot on the path, and reading that slot, which ends with a prefetch of the child.
+    By the time a descent comes back to a step the others have given its cache line time to arrive.
+    visit gets the position of the value in the batch and, like find, the node and the index holding it or nullptr.
+    */
+    struct Descent
+    {
+        BTreeNode<T, t, OrderStatistics>* node;
+        size_t index;
+        bool at_slot;
+    };
+    std::array<Descent, BatchGroupSize> descents;
+    for (size_t i = 0; i < group.size(); i++)
+        descents[i] = { this->root, 0, false };
+
+    size_t active = group.size();
+    while (active > 0)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            Descent& descent = descents[i];
+            if (!descent.node)
+                continue;
+            if (descent.at_slot)
+            {
+                descent.node = descent.node->getChildAtIndex(descent.index);
+                descent.node->prefetch();
+                descent.at_slot = false;
+                continue;
+            }
+            const T& val = vals[group[i]];
+            size_t index = descent.node->findLowerBoundIndexOfVal(val);
+            bool found = index < descent.node->getValsCount() && descent.node->getValAtIndex(index) == val;
+            if (found || descent.node->isLeaf())
+            {
+                visit(group[i], found ? descent.node : nullptr, found ? index : 0);
+                descent.node = nullptr;
+                active--;
+                continue;
+            }
+            descent.node->prefetchChild(index);
+            descent.index = index;
+            descent.at_slot = true;
+        }
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::insertTopDown(const T& val)
+{
+    // a full root is split up front, below it every full child is split before the descent enters it,
+    // so the node that finally takes val always has a free slot
+    if (this->root->getValsCount() == BTreeNode<T, t, OrderStatistics>::MaxVals)
+        this->root->split();
+
+    BTreeNode<T, t, OrderStatistics>* node = this->root;
+    this->countVisit();
+    while (true)
+    {
+        size_t index = node->findLowerBoundIndexOfVal(val);
+        bool found = index < node->getValsCount() && node->getValAtIndex(index) == val;
+        if (found || node->isLeaf())
+        {
+            node->addVal(val);
+            return;
+        }
+        BTreeNode<T, t, OrderStatistics>* child = node->getChildAtIndex(index);
+        if (child->getValsCount() == BTreeNode<T, t, OrderStatistics>::MaxVals)
+        {
+            node->splitChild(index); // the lifted median decides again which side val goes to
+            continue;
+        }
+        node = child;
+        this->countVisit();
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+bool BTree<T, t, OrderStatistics, Strategy>::removeTopDown(const T& val)
+{
+    /*
+    Every child is refilled to at least t values before the descent enters it, so the leaf that finally loses an
+    entry can spare it. When val is found in an inner node the descent goes on to its predecessor, the last entry of
+    the rightmost leaf under the left child, which then takes the place of val.
+    A value that is not in the tree is only noticed in a leaf, the nodes refilled on the way stay valid.
+    */
+    BTreeNode<T, t, OrderStatistics>* node = this->root;
+    BTreeNode<T, t, OrderStatistics>* holder = nullptr; // the inner node holding val, once the predecessor is sought
+    size_t holder_index = 0;
+    this->countVisit();
+    while (true)
+    {
+        size_t index = node->getValsCount();
+        bool found = false;
+        if (!holder)
+        {
+            index = node->findLowerBoundIndexOfVal(val);
+            found = index < node->getValsCount() && node->getValAtIndex(index) == val;
+            if (found && (node->getEntryCount(index) > 1 || node->isLeaf()))
+            {
+                node->removeValueByIndex(index);
+                return true;
+            }
+            if (!found && node->isLeaf())
+                return false;
+        }
+        else if (node->isLeaf())
+        {
+            holder->swapWithPredecessor(node, holder_index);
+            node->removeValueByIndex(node->getValsCount() - 1);
+            return true;
+        }
+
+        if (node->getChildAtIndex(index)->getValsCount() < t)
+        {
+            node->refillChild(index); // a rotation or a merge may move val or the child, the node is searched again
+            continue;
+        }
+        if (found)
+        {
+            holder = node;
+            holder_index = index;
+        }
+        node = node->getChildAtIndex(index);
+        this->countVisit();
+    }
+}
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+typename BTree<T, t, OrderStatistics, Strategy>::iterator BTree<T, t, OrderStatistics, Strategy>::begin()const
+{
+    const BTreeNode<T, t, OrderStatistics>* node = this->root;
+    while (!node->isLeaf())
+        node = node->getChildAtIndex(0);
+    return iterator(node, 0);
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+typename BTree<T, t, OrderStatistics, Strategy>::iterator BTree<T, t, OrderStatistics, Strategy>::end()const
+{
+    const BTreeNode<T, t, OrderStatistics>* node = this->root;
+    while (!node->isLeaf())
+        node = node->getChildAtIndex(node->getChildrenCount() - 1);
+    return iterator(node, node->getValsCount());
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+typename BTree<T, t, OrderStatistics, Strategy>::iterator BTree<T, t, OrderStatistics, Strategy>::lower_bound(const T& val)const
+{
+    // when the leaf has nothing >= val, the answer is the closest separator above val met on the way down
+    iterator candidate = this->end();
+    const BTreeNode<T, t, OrderStatistics>* node = this->root;
+    while (true)
+    {
+        size_t index = node->findLowerBoundIndexOfVal(val);
+        if (index < node->getValsCount())
+        {
+            if (node->isLeaf() || node->getValAtIndex(index) == val)
+                return iterator(node, index);
+            candidate = iterator(node, index);
+        }
+        if (node->isLeaf())
+            return candidate;
+        node = node->getChildAtIndex(index);
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+typename BTree<T, t, OrderStatistics, Strategy>::iterator BTree<T, t, OrderStatistics, Strategy>::upper_bound(const T& val)const
+{
+    iterator it = this->lower_bound(val);
+    if (it != this->end() && *it == val)
+        it.nextEntry();
+    return it;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::pair<typename BTree<T, t, OrderStatistics, Strategy>::iterator, typename BTree<T, t, OrderStatistics, Strategy>::iterator> BTree<T, t, OrderStatistics, Strategy>::equal_range(const T& val)const
+{
+    iterator first = this->lower_bound(val);
+    iterator last = first;
+    if (last != this->end() && *last == val)
+        last.nextEntry();
+    return { first, last };
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::ranges::subrange<typename BTree<T, t, OrderStatistics, Strategy>::iterator> BTree<T, t, OrderStatistics, Strategy>::range(const T& lo, const T& hi)const
+{
+    if (hi < lo)
+        return { this->end(), this->end() };
+    return { this->lower_bound(lo), this->upper_bound(hi) };
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+size_t BTree<T, t, OrderStatistics, Strategy>::count(const T& val)const
+{
+    auto [node, index] = this->find(val);
+    return node ? node->getEntryCount(index) : 0;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+size_t BTree<T, t, OrderStatistics, Strategy>::countBelow(const T& val, bool inclusive)const requires OrderStatistics
+{
+    // everything left of the path to val is counted: the entries before the lower bound and the subtrees between them
+    size_t below = 0;
+    const BTreeNode<T, t, OrderStatistics>* node = this->root;
+    while (true)
+    {
+        size_t index = node->findLowerBoundIndexOfVal(val);
+        for (size_t i = 0; i < index; i++)
+            below += node->getEntryCount(i);
+        if (!node->isLeaf())
+            for (size_t i = 0; i < index; i++)
+                below += node->getChildAtIndex(i)->getSubtreeSize();
+
+        bool found = index < node->getValsCount() && node->getValAtIndex(index) == val;
+        if (found)
+        {
+            if (!node->isLeaf())
+                below += node->getChildAtIndex(index)->getSubtreeSize();
+            return inclusive ? below + node->getEntryCount(index) : below;
+        }
+        if (node->isLeaf())
+            return below;
+        node = node->getChildAtIndex(index);
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+size_t BTree<T, t, OrderStatistics, Strategy>::rank(const T& val)const requires OrderStatistics
+{
+    return this->countBelow(val, false);
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+typename BTree<T, t, OrderStatistics, Strategy>::iterator BTree<T, t, OrderStatistics, Strategy>::select(size_t k)const requires OrderStatistics
+{
+    if (k >= this->size())
+        return this->end();
+
+    // skip whole subtrees and entries left to right until the k-th value falls into one of them
+    const BTreeNode<T, t, OrderStatistics>* node = this->root;
+    while (true)
+    {
+        size_t index = 0;
+        for (; ; index++)
+        {
+            if (!node->isLeaf())
+            {
+                size_t child_size = node->getChildAtIndex(index)->getSubtreeSize();
+                if (k < child_size)
+                    break;
+                k -= child_size;
+            }
+            if (k < node->getEntryCount(index))
+            {
+                iterator it(node, index);
+                it.copy = k;
+                return it;
+            }
+            k -= node->getEntryCount(index);
+        }
+        node = node->getChildAtIndex(index);
+    }
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+size_t BTree<T, t, OrderStatistics, Strategy>::countRange(const T& lo, const T& hi)const requires OrderStatistics
+{
+    if (hi < lo)
+        return 0;
+    return this->countBelow(hi, true) - this->countBelow(lo, false);
+}
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+template <typename InputIt>
+void BTree<T, t, OrderStatistics, Strategy>::bulkLoad(InputIt first, InputIt last, double fill_factor, size_t threads)
+{
+    if (!(fill_factor > 0.0 && fill_factor <= 1.0))
+        throw std::invalid_argument(std::format("Fill factor must be in (0, 1], got {}", fill_factor));
+
+    // fold the runs of equal values into entries before the current contents are dropped
+    std::vector<T> vals;
+    std::vector<size_t> counts;
+    if constexpr (std::forward_iterator<InputIt>)
+        vals.reserve(std::distance(first, last));
+    for (; first != last; ++first)
+    {
+        if (!vals.empty() && *first == vals.back())
+        {
+            counts.back()++;
+            continue;
+        }
+        if (!vals.empty() && *first < vals.back())
+            throw std::invalid_argument("bulkLoad expects a sorted range");
+        vals.push_back(*first);
+        counts.push_back(1);
+    }
+
+    // an empty root keeps the tree valid while the new levels are being built
+    this->destroySubtree(this->root);
+    this->root = this->pool.create(&this->pool);
+
+    // every level turns into the nodes for the children of the level above and the separators between them
+    std::vector<BTreeNode<T, t, OrderStatistics>*> children;
+    while (vals.size() > 2 * t - 2)
+        children = this->buildLevel(vals, counts, children, fill_factor, threads);
+
+    BTreeNode<T, t, OrderStatistics>* new_root = this->pool.create(&this->pool, nullptr, true, children.empty());
+    for (size_t i = 0; i < vals.size(); i++)
+        new_root->appendEntry(std::move(vals[i]), counts[i]);
+    for (BTreeNode<T, t, OrderStatistics>* child : children)
+        new_root->appendChild(child);
+
+    this->pool.destroy(this->root);
+    this->root = new_root;
+}
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+size_t BTree<T, t, OrderStatistics, Strategy>::nodesForLevel(size_t vals_count, double fill_factor)
+{
+    // m nodes hold vals_count - (m - 1) values, the m - 1 separators between them go one level up
+    size_t target = std::clamp<size_t>(static_cast<size_t>(fill_factor * (2 * t - 2) + 0.5), t - 1, 2 * t - 2);
+    size_t fewest = (vals_count + 2 * t - 1) / (2 * t - 1); // with fewer nodes some would exceed 2t - 2 values
+    size_t most = (vals_count + 1) / t;                      // with more nodes some would fall below t - 1 values
+    size_t wanted = (vals_count + target + 1) / (target + 1);
+    return std::clamp(wanted, fewest, most);
+}
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+std::vector<BTreeNode<T, t, OrderStatistics>*> BTree<T, t, OrderStatistics, Strategy>::buildLevel(std::vector<T>& vals, std::vector<size_t>& counts,
+                                                      const std::vector<BTreeNode<T, t, OrderStatistics>*>& children,
+                                                      double fill_factor, size_t threads)
+{
+    static constexpr size_t MinNodesPerThread = 1024;
+
+    size_t nodes_count = nodesForLevel(vals.size(), fill_factor);
+    size_t per_node = (vals.size() - nodes_count + 1) / nodes_count;
+    size_t extra = (vals.size() - nodes_count + 1) % nodes_count; // the first extra nodes take one more value
+    bool is_leaf = children.empty();
+
+    // the pool is not thread-safe, so the nodes are allocated up front and only filled concurrently
+    std::vector<BTreeNode<T, t, OrderStatistics>*> nodes(nodes_count);
+    for (BTreeNode<T, t, OrderStatistics>*& node : nodes)
+        node = this->pool.create(&this->pool, nullptr, false, is_leaf);
+
+    auto fill = [&](size_t first_node, size_t last_node)
+    {
+        for (size_t i = first_node; i < last_node; i++)
+        {
+            size_t begin = i * (per_node + 1) + std::min(i, extra);
+            size_t end = begin + per_node + (i < extra ? 1 : 0);
+            for (size_t j = begin; j < end; j++)
+                nodes[i]->appendEntry(std::move(vals[j]), counts[j]);
+            if (!is_leaf)
+                for (size_t j = begin; j <= end; j++)
+                    nodes[i]->appendChild(children[j]);
+        }
+    };
+    size_t workers = std::min(threads, nodes_count / MinNodesPerThread);
+    if (workers <= 1)
+    {
+        fill(0, nodes_count);
+    }
+    else
+    {
+        std::vector<std::jthread> fillers;
+        size_t chunk = (nodes_count + workers - 1) / workers;
+        for (size_t first_node = 0; first_node < nodes_count; first_node += chunk)
+            fillers.emplace_back(fill, first_node, std::min(first_node + chunk, nodes_count));
+    }
+
+    // the value right after every node but the last one separates it from its right neighbour
+    std::vector<T> separators;
+    std::vector<size_t> separator_counts;
+    separators.reserve(nodes_count - 1);
+    separator_counts.reserve(nodes_count - 1);
+    for (size_t i = 1; i < nodes_count; i++)
+    {
+        size_t index = i * (per_node + 1) + std::min(i, extra) - 1;
+        separators.push_back(std::move(vals[index]));
+        separator_counts.push_back(counts[index]);
+    }
+    vals = std::move(separators);
+    counts = std::move(separator_counts);
+    return nodes;
+}
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::checkInvariants()const
+{
+    // bottom-up a node is split as soon as its last slot fills, top-down only before an insertion passes through it
+    constexpr size_t MaxVals = Strategy == Restructuring::TopDown ? BTreeNode<T, t, OrderStatistics>::MaxVals
+                                                                  : BTreeNode<T, t, OrderStatistics>::MaxVals - 1;
+    size_t leaf_depth = 0;
+    this->root->checkSubtree(nullptr, nullptr, MaxVals, 1, leaf_depth);
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+TreeStats BTree<T, t, OrderStatistics, Strategy>::stats()const requires StatsEnabled
+{
+    TreeStats stats{};
+    std::vector<const BTreeNode<T, t, OrderStatistics>*> pending{ this->root };
+    while (!pending.empty())
+    {
+        const BTreeNode<T, t, OrderStatistics>* node = pending.back();
+        pending.pop_back();
+        stats.nodes++;
+        stats.entries += node->getValsCount();
+        for (size_t i = 0; i < node->getChildrenCount(); i++)
+            pending.push_back(node->getChildAtIndex(i));
+    }
+    for (const BTreeNode<T, t, OrderStatistics>* node = this->root; ; node = node->getChildAtIndex(0))
+    {
+        stats.height++;
+        if (node->isLeaf())
+            break;
+    }
+
+    // bottom-up the last slot of a node only ever holds the value that is about to split it
+    constexpr size_t Slots = Strategy == Restructuring::TopDown ? BTreeNode<T, t, OrderStatistics>::MaxVals
+                                                                : BTreeNode<T, t, OrderStatistics>::MaxVals - 1;
+    stats.fill_factor = static_cast<double>(stats.entries) / static_cast<double>(stats.nodes * Slots);
+    stats.find = this->operation_counts.kinds[static_cast<size_t>(OperationKind::Find)];
+    stats.insert = this->operation_counts.kinds[static_cast<size_t>(OperationKind::Insert)];
+    stats.remove = this->operation_counts.kinds[static_cast<size_t>(OperationKind::Remove)];
+    stats.restructurings = this->pool.restructurings;
+    return stats;
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::resetStats() requires StatsEnabled
+{
+    this->operation_counts = {};
+    this->pool.restructurings = {};
+}
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+void BTree<T, t, OrderStatistics, Strategy>::printBTree(const BTreeNode<T, t, OrderStatistics>* node, std::ostream &o, const std::string& prefix, bool is_last) const{
     o << prefix;
     o << (is_last ? "└── " : "├── ");
     
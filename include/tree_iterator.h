@@ -0,0 +1,134 @@
+#ifndef TREE_ITERATOR_H
+#define TREE_ITERATOR_H
+#include <cstddef>
+#include <iterator>
+#include "node.h"
+
+template <typename T, size_t t, bool OrderStatistics, Restructuring Strategy>
+class BTree;
+
+/*
+Bidirectional iterator over the values of a BTree in ascending order.
+A value stored with a duplicate count of k is visited k times.
+Stepping between nodes follows the parent pointer and the slot every node keeps in its parent,
+so a full scan visits each node a constant number of times and never searches a children array.
+The end position is one past the last value of the rightmost leaf.
+*/
+template <typename T, size_t t, bool OrderStatistics>
+class BTreeIterator
+{
+public:
+    using iterator_concept = std::bidirectional_iterator_tag;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+private:
+    template <typename, size_t, bool, Restructuring>
+    friend class BTree;
+
+    const BTreeNode<T, t, OrderStatistics>* node;
+    size_t index;
+    size_t copy; // which of the duplicates of the current value is visited
+
+public:
+    BTreeIterator() : node(nullptr), index(0), copy(0) {}
+    BTreeIterator(const BTreeNode<T, t, OrderStatistics>* node, size_t index) : node(node), index(index), copy(0) {}
+
+    reference operator*()const
+    {
+        return this->node->keys[this->index];
+    }
+    pointer operator->()const
+    {
+        return &this->node->keys[this->index];
+    }
+    BTreeIterator& operator++()
+    {
+        if (this->copy + 1 < this->node->counts[this->index])
+            this->copy++;
+        else
+            this->nextEntry();
+        return *this;
+    }
+    BTreeIterator operator++(int)
+    {
+        BTreeIterator old = *this;
+        ++*this;
+        return old;
+    }
+    BTreeIterator& operator--()
+    {
+        if (this->copy > 0)
+        {
+            this->copy--;
+        }
+        else
+        {
+            this->previousEntry();
+            this->copy = this->node->counts[this->index] - 1;
+        }
+        return *this;
+    }
+    BTreeIterator operator--(int)
+    {
+        BTreeIterator old = *this;
+        --*this;
+        return old;
+    }
+    bool operator==(const BTreeIterator& other)const = default;
+
+private:
+    // move to the first copy of the next distinct value
+    void nextEntry()
+    {
+        this->copy = 0;
+        if (!this->node->is_leaf)
+        {
+            this->node = this->node->children[this->index + 1];
+            while (!this->node->is_leaf)
+                this->node = this->node->children[0];
+            this->index = 0;
+            return;
+        }
+        if (++this->index < this->node->vals_count)
+            return;
+
+        // past the end of a leaf the next value is the separator above the first ancestor that is not a last child
+        const BTreeNode<T, t, OrderStatistics>* leaf = this->node;
+        while (this->node->parent && this->node->position == this->node->parent->vals_count)
+            this->node = this->node->parent;
+        if (!this->node->parent)
+        {
+            this->node = leaf; // that was the last value of the tree, stay at the end position
+            return;
+        }
+        this->index = this->node->position;
+        this->node = this->node->parent;
+    }
+    // move to the last value before the current one, decrementing begin() is undefined like for standard containers
+    void previousEntry()
+    {
+        if (!this->node->is_leaf)
+        {
+            this->node = this->node->children[this->index];
+            while (!this->node->is_leaf)
+                this->node = this->node->children[this->node->children_count - 1];
+            this->index = this->node->vals_count - 1;
+            return;
+        }
+        if (this->index > 0)
+        {
+            this->index--;
+            return;
+        }
+
+        while (this->node->parent && this->node->position == 0)
+            this->node = this->node->parent;
+        this->index = this->node->position - 1;
+        this->node = this->node->parent;
+    }
+};
+#endif
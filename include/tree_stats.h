@@ -0,0 +1,67 @@
+#ifndef TREE_STATS_H
+#define TREE_STATS_H
+#include <cstddef>
+#include "node_pool.h"
+
+
+/*
+Instrumentation of BTree, compiled in only when BTREE_ENABLE_STATS is defined (the CMake option of the same name).
+Without it the counters take no space in the tree or its pool and the code updating them is discarded at compile
+time. Every translation unit of a program has to agree on the macro.
+*/
+#if defined(BTREE_ENABLE_STATS)
+inline constexpr bool StatsEnabled = true;
+#else
+inline constexpr bool StatsEnabled = false;
+#endif
+
+// how many times each restructuring step ran
+struct RestructuringCounts
+{
+    size_t split;      // a node other than the root split in two, the median going up into its parent
+    size_t split_root; // the root split, the tree growing by one level
+    size_t rotate_left;
+    size_t rotate_right;
+    size_t merge_with_left;
+    size_t merge_with_right;
+};
+
+// the node pool of a tree with stats also carries its restructuring counts, so every node reaches them
+template <typename Node>
+struct CountingNodePool : NodePool<Node>
+{
+    RestructuringCounts restructurings{};
+};
+
+// the single-value calls the stats of a tree count apart
+enum class OperationKind
+{
+    Find,
+    Insert,
+    Remove
+};
+
+// the calls of one kind since the last reset and the nodes they entered on the way down
+struct OperationCounts
+{
+    size_t calls;
+    size_t nodes_visited;
+
+    double nodesVisitedPerCall()const
+    {
+        return this->calls ? static_cast<double>(this->nodes_visited) / this->calls : 0.0;
+    }
+};
+
+struct TreeStats
+{
+    size_t nodes;
+    size_t height;       // levels from the root down to the leaves, 1 for a root without children
+    size_t entries;      // distinct values, the duplicates of a value share its entry
+    double fill_factor;  // entries over the value slots of all the nodes
+    OperationCounts find;   // find and count
+    OperationCounts insert; // insert and every value of insertBatch
+    OperationCounts remove; // remove and every value of removeBatch
+    RestructuringCounts restructurings;
+};
+#endif
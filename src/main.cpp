@@ -18,7 +18,7 @@ int main() {
 	#endif
 	
 	
-	BTree<int> tree(2);
+	BTree<int, 2> tree;
 	
 	
 	for (int i = LowerBound; i <= UpperBound; i++) {
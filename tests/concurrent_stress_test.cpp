@@ -0,0 +1,139 @@
+#include <latch>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "concurrent_tree.h"
+#include "test_util.h"
+
+
+/*
+Multi-threaded correctness test of ConcurrentBTree. The threads run random lookups, insertions and removals over
+one key space where three kinds of keys are interleaved, so the splits and merges of one kind move the others:
+    owned   keys a single thread changes, every result is checked against that thread's model while it runs
+    shared  keys every thread inserts and removes, a removal may lose its value to another thread; once the threads
+            are done each key must hold the insertions minus the successful removals of all threads
+    pinned  keys inserted up front and never removed, every lookup must find exactly one copy
+Removals of negative keys, which are never inserted, must all fail. After the threads join the whole key space is
+compared with the merged models. t = 2 restructures on almost every update, t = 16 is the benchmarked degree.
+*/
+constexpr int Threads = 4;
+constexpr int SharedKind = Threads;     // key % Kinds below Threads is the thread owning the key
+constexpr int PinnedKind = Threads + 1;
+constexpr int Kinds = Threads + 2;
+
+template <size_t t>
+void stress(int slots, size_t operations, unsigned seed)
+{
+    ConcurrentBTree<int, t> tree;
+    for (int slot = 0; slot < slots; slot++)
+        tree.insert(slot * Kinds + PinnedKind);
+
+    std::vector<std::vector<size_t>> owned(Threads, std::vector<size_t>(slots)); // copies of the owned key per slot
+    std::vector<std::vector<long>> shared_net(Threads, std::vector<long>(slots)); // insertions minus removals
+    std::mutex error_mutex;
+    std::string error;
+    std::latch start(Threads);
+    {
+        std::vector<std::jthread> workers;
+        for (int w = 0; w < Threads; w++)
+        {
+            workers.emplace_back([&, w]
+            {
+                try
+                {
+                    std::mt19937 rng(seed * Threads + w);
+                    std::vector<size_t>& model = owned[w];
+                    std::vector<long>& net = shared_net[w];
+                    start.arrive_and_wait();
+                    for (size_t i = 0; i < operations; i++)
+                    {
+                        int slot = static_cast<int>(rng() % slots);
+                        unsigned roll = rng() % 100;
+                        switch (rng() % 3)
+                        {
+                        case 0:
+                        {
+                            int key = slot * Kinds + w;
+                            if (roll < 40)
+                            {
+                                tree.insert(key);
+                                model[slot]++;
+                            }
+                            else if (roll < 75)
+                            {
+                                bool removed = tree.remove(key);
+                                test::expect(removed == (model[slot] > 0), "remove({}) returned {} with {} copies",
+                                             key, removed, model[slot]);
+                                model[slot] -= removed;
+                            }
+                            size_t count = tree.count(key);
+                            test::expect(count == model[slot], "count({}) is {}, expected {}", key, count, model[slot]);
+                            break;
+                        }
+                        case 1:
+                        {
+                            int key = slot * Kinds + SharedKind;
+                            if (roll < 50)
+                            {
+                                tree.insert(key);
+                                net[slot]++;
+                            }
+                            else
+                            {
+                                net[slot] -= tree.remove(key);
+                            }
+                            break;
+                        }
+                        default:
+                        {
+                            int key = slot * Kinds + PinnedKind;
+                            size_t count = tree.count(key);
+                            test::expect(count == 1, "count({}) of a pinned key is {}", key, count);
+                            test::expect(!tree.remove(-key), "remove({}) of a key never inserted succeeded", -key);
+                            break;
+                        }
+                        }
+                    }
+                }
+                catch (const std::exception& failure)
+                {
+                    std::lock_guard lock(error_mutex);
+                    if (error.empty())
+                        error = failure.what();
+                }
+            });
+        }
+    }
+    test::expect(error.empty(), "t = {}, seed {}: {}", t, seed, error);
+
+    for (int slot = 0; slot < slots; slot++)
+    {
+        long shared = 0;
+        for (int w = 0; w < Threads; w++)
+        {
+            int key = slot * Kinds + w;
+            test::expect(tree.count(key) == owned[w][slot], "t = {}: count({}) is {} after the run, expected {}",
+                         t, key, tree.count(key), owned[w][slot]);
+            shared += shared_net[w][slot];
+        }
+        int key = slot * Kinds + SharedKind;
+        test::expect(shared >= 0 && tree.count(key) == static_cast<size_t>(shared),
+                     "t = {}: count({}) is {} after the run, the threads left {}", t, key, tree.count(key), shared);
+        test::expect(tree.count(slot * Kinds + PinnedKind) == 1, "t = {}: pinned key {} was lost", t,
+                     slot * Kinds + PinnedKind);
+    }
+}
+
+int main()
+{
+    return test::run("concurrent_stress_test", []
+    {
+        for (unsigned seed = 0; seed < 3; seed++)
+        {
+            stress<2>(2'000, 100'000, seed);
+            stress<16>(20'000, 100'000, seed);
+        }
+    });
+}
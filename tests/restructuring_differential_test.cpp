@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <format>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "test_util.h"
+#include "tree.h"
+
+
+/*
+Differential test of the restructuring strategies. A bottom-up and a top-down BTree, each with and without
+OrderStatistics, run the same random updates as a std::multiset over a small key range, so most keys are repeated.
+Every round grows the trees, mixes insertions and removals, then drains them to empty in random order. Removing a
+key the model does not hold must throw and leave the contents as they were. After every update the copies of the
+touched key are compared, and every CheckEvery updates and at the end of each phase the whole contents, the order
+statistics and the structural invariants are checked: the node bounds of the strategy, the key order, the parent
+and position links, the leaf depth and the subtree sizes.
+*/
+constexpr size_t CheckEvery = 61;
+
+template <typename Tree>
+void checkTree(const Tree& tree, const std::multiset<int>& model, const std::string& where)
+{
+    try
+    {
+        tree.checkInvariants();
+    }
+    catch (const std::logic_error& error)
+    {
+        throw std::runtime_error(std::format("{}: {}", where, error.what()));
+    }
+    test::expect(std::equal(tree.begin(), tree.end(), model.begin(), model.end()),
+                 "{}: the contents differ from the model", where);
+    if constexpr (requires { tree.size(); })
+    {
+        test::expect(tree.size() == model.size(), "{}: size() is {}, expected {}", where, tree.size(), model.size());
+        for (int key : { -1, model.empty() ? 0 : *model.begin(), model.empty() ? 0 : *model.rbegin() + 1 })
+        {
+            size_t rank = static_cast<size_t>(std::distance(model.begin(), model.lower_bound(key)));
+            test::expect(tree.rank(key) == rank, "{}: rank({}) is {}, expected {}", where, key, tree.rank(key), rank);
+        }
+        if (!model.empty())
+        {
+            int middle = *std::next(model.begin(), static_cast<std::ptrdiff_t>(model.size() / 2));
+            test::expect(*tree.select(model.size() / 2) == middle, "{}: select({}) is not {}", where, model.size() / 2,
+                         middle);
+        }
+    }
+}
+
+template <size_t t>
+void differential(int key_range, size_t operations, unsigned seed)
+{
+    BTree<int, t> bottom_up;
+    BTree<int, t, false, Restructuring::TopDown> top_down;
+    BTree<int, t, true> ranked_bottom_up;
+    BTree<int, t, true, Restructuring::TopDown> ranked_top_down;
+    auto each = [&](auto&& step)
+    {
+        step(bottom_up, "bottom-up");
+        step(top_down, "top-down");
+        step(ranked_bottom_up, "bottom-up with order statistics");
+        step(ranked_top_down, "top-down with order statistics");
+    };
+    std::multiset<int> model;
+    std::mt19937 rng(seed);
+
+    auto insert = [&](int key)
+    {
+        each([key](auto& tree, const char*) { tree.insert(key); });
+        model.insert(key);
+    };
+    auto remove = [&](int key, const std::string& where)
+    {
+        if (model.contains(key))
+        {
+            each([key](auto& tree, const char*) { tree.remove(key); });
+            model.erase(model.find(key));
+            return;
+        }
+        each([&](auto& tree, const char* name)
+        {
+            bool thrown = false;
+            try
+            {
+                tree.remove(key);
+            }
+            catch (const std::runtime_error&)
+            {
+                thrown = true;
+            }
+            test::expect(thrown, "{}, {}: remove({}) of a missing key did not throw", where, name, key);
+        });
+    };
+    auto check = [&](int key, size_t step, const std::string& where)
+    {
+        each([&](auto& tree, const char* name)
+        {
+            test::expect(tree.count(key) == model.count(key), "{}, {}: count({}) is {}, expected {}", where, name, key,
+                         tree.count(key), model.count(key));
+            if (step % CheckEvery == 0)
+                checkTree(tree, model, std::format("{}, {}", where, name));
+        });
+    };
+
+    for (int round = 0; round < 3; round++)
+    {
+        // the share of insertions falls from two thirds while growing to one half in the mixed phase
+        for (unsigned insert_sixths : { 4u, 3u })
+        {
+            std::string where = std::format("t = {}, seed {}, round {}, {} phase", t, seed, round,
+                                            insert_sixths == 4 ? "growing" : "mixed");
+            for (size_t i = 1; i <= operations; i++)
+            {
+                int key = static_cast<int>(rng() % static_cast<unsigned>(key_range));
+                if (rng() % 6 < insert_sixths)
+                    insert(key);
+                else
+                    remove(key, where);
+                check(key, i, where);
+            }
+            check(0, 0, where);
+        }
+
+        std::string where = std::format("t = {}, seed {}, round {}, draining phase", t, seed, round);
+        std::vector<int> rest(model.begin(), model.end());
+        std::shuffle(rest.begin(), rest.end(), rng);
+        for (size_t i = 1; i <= rest.size(); i++)
+        {
+            remove(rest[i - 1], where);
+            check(rest[i - 1], i, where);
+        }
+        test::expect(model.empty(), "{}: the model was not drained", where);
+        check(0, 0, where);
+        remove(0, where);
+    }
+}
+
+int main()
+{
+    return test::run("restructuring_differential_test", []
+    {
+        for (unsigned seed = 0; seed < 3; seed++)
+        {
+            differential<2>(300, 4'000, seed);
+            differential<3>(1'000, 6'000, seed);
+            differential<16>(3'000, 10'000, seed);
+        }
+    });
+}
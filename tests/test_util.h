@@ -0,0 +1,40 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+#include <exception>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+
+/*
+Helpers shared by the test executables.
+A test is a plain program run by ctest: a failed expectation throws, run() reports it and turns it into the nonzero
+exit code ctest looks for. The message is only formatted when the expectation fails, so checks can sit in hot loops.
+*/
+namespace test
+{
+    template <typename... Args>
+    void expect(bool condition, std::format_string<Args...> message, Args&&... args)
+    {
+        if (!condition)
+            throw std::runtime_error(std::format(message, std::forward<Args>(args)...));
+    }
+
+    template <typename Body>
+    int run(const char* name, Body body)
+    {
+        try
+        {
+            body();
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << std::format("{}: FAILED: {}\n", name, error.what());
+            return 1;
+        }
+        std::cout << std::format("{}: passed\n", name);
+        return 0;
+    }
+}
+#endif